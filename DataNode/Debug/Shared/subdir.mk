@@ -5,15 +5,19 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/bitmap.c \
+/home/utnso/git/tp-2017-2c-YATPOS/Shared/buffer.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/config.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/data.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/file.c \
+/home/utnso/git/tp-2017-2c-YATPOS/Shared/heap.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/log.c \
+/home/utnso/git/tp-2017-2c-YATPOS/Shared/metrics.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/mlist.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/mstring.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/mtime.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/number.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/path.c \
+/home/utnso/git/tp-2017-2c-YATPOS/Shared/pipeline.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/process.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/protocol.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/serial.c \
@@ -21,19 +25,24 @@ C_SRCS += \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/struct.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/system.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/thread.c \
+/home/utnso/git/tp-2017-2c-YATPOS/Shared/trace.c \
 /home/utnso/git/tp-2017-2c-YATPOS/Shared/yfile.c 
 
 OBJS += \
 ./Shared/bitmap.o \
+./Shared/buffer.o \
 ./Shared/config.o \
 ./Shared/data.o \
 ./Shared/file.o \
+./Shared/heap.o \
 ./Shared/log.o \
+./Shared/metrics.o \
 ./Shared/mlist.o \
 ./Shared/mstring.o \
 ./Shared/mtime.o \
 ./Shared/number.o \
 ./Shared/path.o \
+./Shared/pipeline.o \
 ./Shared/process.o \
 ./Shared/protocol.o \
 ./Shared/serial.o \
@@ -41,19 +50,24 @@ OBJS += \
 ./Shared/struct.o \
 ./Shared/system.o \
 ./Shared/thread.o \
+./Shared/trace.o \
 ./Shared/yfile.o 
 
 C_DEPS += \
 ./Shared/bitmap.d \
+./Shared/buffer.d \
 ./Shared/config.d \
 ./Shared/data.d \
 ./Shared/file.d \
+./Shared/heap.d \
 ./Shared/log.d \
+./Shared/metrics.d \
 ./Shared/mlist.d \
 ./Shared/mstring.d \
 ./Shared/mtime.d \
 ./Shared/number.d \
 ./Shared/path.d \
+./Shared/pipeline.d \
 ./Shared/process.d \
 ./Shared/protocol.d \
 ./Shared/serial.d \
@@ -61,6 +75,7 @@ C_DEPS += \
 ./Shared/struct.d \
 ./Shared/system.d \
 ./Shared/thread.d \
+./Shared/trace.d \
 ./Shared/yfile.d 
 
 
@@ -72,6 +87,13 @@ Shared/bitmap.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/bitmap.c
 	@echo 'Finished building: $<'
 	@echo ' '
 
+Shared/buffer.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/buffer.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C Compiler'
+	gcc -std=gnu11 -I"/home/utnso/git/tp-2017-2c-YATPOS/Shared" -O0 -g3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 Shared/config.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/config.c
 	@echo 'Building file: $<'
 	@echo 'Invoking: GCC C Compiler'
@@ -93,6 +115,13 @@ Shared/file.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/file.c
 	@echo 'Finished building: $<'
 	@echo ' '
 
+Shared/heap.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/heap.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C Compiler'
+	gcc -std=gnu11 -I"/home/utnso/git/tp-2017-2c-YATPOS/Shared" -O0 -g3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 Shared/log.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/log.c
 	@echo 'Building file: $<'
 	@echo 'Invoking: GCC C Compiler'
@@ -100,6 +129,13 @@ Shared/log.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/log.c
 	@echo 'Finished building: $<'
 	@echo ' '
 
+Shared/metrics.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/metrics.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C Compiler'
+	gcc -std=gnu11 -I"/home/utnso/git/tp-2017-2c-YATPOS/Shared" -O0 -g3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 Shared/mlist.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/mlist.c
 	@echo 'Building file: $<'
 	@echo 'Invoking: GCC C Compiler'
@@ -135,6 +171,13 @@ Shared/path.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/path.c
 	@echo 'Finished building: $<'
 	@echo ' '
 
+Shared/pipeline.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/pipeline.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C Compiler'
+	gcc -std=gnu11 -I"/home/utnso/git/tp-2017-2c-YATPOS/Shared" -O0 -g3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 Shared/process.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/process.c
 	@echo 'Building file: $<'
 	@echo 'Invoking: GCC C Compiler'
@@ -184,6 +227,13 @@ Shared/thread.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/thread.c
 	@echo 'Finished building: $<'
 	@echo ' '
 
+Shared/trace.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/trace.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C Compiler'
+	gcc -std=gnu11 -I"/home/utnso/git/tp-2017-2c-YATPOS/Shared" -O0 -g3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 Shared/yfile.o: /home/utnso/git/tp-2017-2c-YATPOS/Shared/yfile.c
 	@echo 'Building file: $<'
 	@echo 'Invoking: GCC C Compiler'
@@ -1,6 +1,8 @@
 #include <config.h>
 #include <data.h>
+#include <layout.h>
 #include <log.h>
+#include <metrics.h>
 #include <mstring.h>
 #include <process.h>
 #include <protocol.h>
@@ -11,6 +13,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <thread.h>
+#include <trace.h>
 
 static t_socket fs_socket = -1;
 
@@ -49,11 +52,11 @@ int main(int argc, char *argv[]) {
 // ========== Funciones privadas ==========
 
 static void connect_to_filesystem() {
-	t_socket socket = socket_connect(config_get("IP_FILESYSTEM"), config_get("PUERTO_FILESYSTEM"));
+	t_socket socket = socket_connect_profile(config_get("IP_FILESYSTEM"), config_get("PUERTO_FILESYSTEM"), SOCKET_BULK);
 	if(socket == -1) puts("Esperando conexión del FileSystem...");
 	while(socket == -1) {
 		thread_sleep(500);
-		socket = socket_connect(config_get("IP_FILESYSTEM"), config_get("PUERTO_FILESYSTEM"));
+		socket = socket_connect_profile(config_get("IP_FILESYSTEM"), config_get("PUERTO_FILESYSTEM"), SOCKET_BULK);
 	}
 
 	protocol_send_handshake(socket);
@@ -79,9 +82,17 @@ static void handle_request(t_packet request) {
 		log_report("Operación inválida. Código de operación: %i", request.operation);
 		return;
 	}
-	int blockno, receiving;
-	serial_unpack(request.content, "ii", &blockno, &receiving);
-	if(receiving) {
+	t_layout_request_block pedido;
+	bool valido = layout_request_block_read(&pedido, request.content->data, request.content->size);
+	serial_destroy(request.content);
+	if(!valido) {
+		log_report("Pedido de bloque incompleto");
+		return;
+	}
+	int blockno = pedido.blockno;
+	trace_set(request.trace);
+	uint64_t inicioTraza = trace_now();
+	if(pedido.receiving) {
 		log_print("Solicitud de escritura de bloque #%i", blockno);
 		t_packet packet = protocol_receive_packet(fs_socket);
 		if(packet.operation != OP_SEND_BLOCK) {
@@ -90,12 +101,18 @@ static void handle_request(t_packet request) {
 		}
 		data_set(blockno, packet.content->data);
 		serial_destroy(packet.content);
+		metrics_add(metrics_counter("datanode_bloques_escritos_total"), 1);
+		trace_span("escritura_bloque", inicioTraza, trace_now(), "bloque %d", blockno);
 	} else {
 		log_print("Solicitud de lectura de bloque #%i", blockno);
+		// Incluye los fallos de página al leer el bloque del mapeo mientras se envía
+		uint64_t inicio = metrics_now();
 		t_serial *block = serial_create(data_get(blockno), BLOCK_SIZE);
 		t_packet response = protocol_packet(OP_SEND_BLOCK, block);
 		protocol_send_packet(response, fs_socket);
 		free(block);
+		metrics_since(metrics_histogram("datanode_lectura_us"), inicio);
+		trace_span("lectura_bloque", inicioTraza, trace_now(), "bloque %d", blockno);
 	}
 }
 
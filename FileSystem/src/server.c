@@ -2,14 +2,17 @@
 
 #include <config.h>
 #include <log.h>
+#include <metrics.h>
 #include <process.h>
 #include <protocol.h>
+#include <layout.h>
 #include <serial.h>
 #include <socket.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <thread.h>
+#include <trace.h>
 #include <data.h>
 #include <path.h>
 #include <string.h>
@@ -38,6 +41,7 @@ t_nodeop *server_nodeop(int opcode, int blockno, void *block) {
 	op->opcode = opcode;
 	op->blockno = blockno;
 	op->block = block;
+	op->trace = trace_current();
 	return op;
 }
 
@@ -69,24 +73,25 @@ static t_node *receive_node_info(t_socket socket) {
 }
 
 static void node_listener() {
-	t_socket sv_sock = socket_init(NULL, config_get("PUERTO_NODO"));
+	// Por este puerto viajan los bloques: los DataNodes aceptados heredan el perfil
+	t_socket sv_sock = socket_init_profile(NULL, config_get("PUERTO_NODO"), SOCKET_BULK);
 
 	while(thread_active()) {
 		t_socket cli_sock = socket_accept(sv_sock);
 		nodelist_refresh();
 
-		t_packet packet = protocol_receive_packet(cli_sock);
-		serial_destroy(packet.content);
-
-		if(packet.operation != OP_HANDSHAKE) {
+		t_process sender = protocol_receive_handshake(cli_sock);
+		if(sender != PROC_DATANODE && sender != PROC_WORKER) {
+			// Otro proceso o un nodo con otra versión del protocolo
+			log_inform("Se rechaza conexión en el socket %d: apretón de manos inválido", cli_sock);
 			socket_close(cli_sock);
-			break;
+			continue;
 		}
 
 		char *ip = socket_address(cli_sock);
 		char *port = socket_port(cli_sock);
 
-		if (packet.sender == PROC_DATANODE) {
+		if (sender == PROC_DATANODE) {
 			t_node *node = receive_node_info(cli_sock);
 
 			if(node == NULL) {
@@ -101,7 +106,7 @@ static void node_listener() {
 
 			node->socket = cli_sock;
 			node->handler = thread_create(datanode_handler, node);
-		} else if (packet.sender == PROC_WORKER) {
+		} else {
 			protocol_send_response(cli_sock, RESPONSE_OK);
 
 			log_inform("Worker conectado desde %s:%s", ip, port);
@@ -117,33 +122,42 @@ static void node_listener() {
 }
 
 static void worker_handler(t_socket worker_socket) {
-	t_packet packet = protocol_receive_packet(worker_socket);
-	char *buffer, *ypath;
-	int size;
+	// El archivo llega en flujo: se escribe a disco sin cargarlo entero en memoria
+	uint64_t size;
+	t_packet packet = protocol_receive_stream(worker_socket, &size);
+	char *ypath;
+	trace_set(packet.trace);
 
 	if (packet.content != NULL && packet.operation == OP_INICIAR_ALMACENAMIENTO) {
 		log_inform("OP_INICIAR_ALMACENAMIENTO");
-		serial_unpack(packet.content, "ssi", &buffer, &ypath, &size);
+		serial_unpack(packet.content, "s", &ypath);
+		uint64_t inicio = trace_now();
 
 		if(filetable_contains(ypath)) {
 			log_inform("El archivo ya existe");
+			protocol_receive_file(worker_socket, -1, size);
 			protocol_send_response(worker_socket, RESPONSE_ERROR);
-			free(buffer);
 			free(ypath);
 		} else {
 			mstring_format(&ypath, "%s", path_create(PTYPE_YAMA, ypath));
 
 			t_file* file = file_create(path_name(ypath));
-			fwrite(buffer, sizeof(char), size, file_pointer(file));
-			free(buffer);
+			bool recibido = protocol_receive_file(worker_socket, fileno(file_pointer(file)), size);
+			trace_span("recepcion", inicio, trace_now(), "%s: %llu bytes", ypath, (unsigned long long) size);
 
 			char *path = mstring_duplicate(file_path(file));
 			file_close(file);
 
-			char *dir = path_dir(ypath);
-
-			filetable_cpfrom(path, dir);
-			free(dir);
+			if(recibido) {
+				// Los bloques salen por los hilos de cada DataNode, que heredan el job por t_nodeop
+				uint64_t inicioCopia = trace_now();
+				char *dir = path_dir(ypath);
+				filetable_cpfrom(path, dir);
+				free(dir);
+				trace_span("almacenamiento", inicioCopia, trace_now(), "%s", ypath);
+			} else {
+				log_report("No se recibió completo el archivo %s", ypath);
+			}
 
 			path_remove(path);
 			free(path);
@@ -160,6 +174,7 @@ static void worker_handler(t_socket worker_socket) {
 		}
 	} else {
 		log_inform("OP_UNDEFINED");
+		serial_destroy(packet.content);
 		protocol_send_response(worker_socket, RESPONSE_ERROR);
 	}
 
@@ -173,10 +188,8 @@ static void yama_listener() {
 	while(thread_active()) {
 		t_socket yama_socket = socket_accept(sv_sock);
 
-		t_packet packet = protocol_receive_packet(yama_socket);
-		serial_destroy(packet.content);
-
-		if(packet.operation != OP_HANDSHAKE || packet.sender != PROC_YAMA) {
+		if(protocol_receive_handshake(yama_socket) != PROC_YAMA) {
+			log_inform("Se rechaza conexión en el socket %d: apretón de manos inválido", yama_socket);
 			socket_close(yama_socket);
 			continue;
 		}
@@ -202,8 +215,10 @@ static void yama_handler(t_socket yama_socket) {
 	while(thread_active()) {
 
 		t_packet packet = protocol_receive_packet(yama_socket);
+		trace_set(packet.trace);
 		if (packet.operation == OP_REQUEST_FILE_INFO) {
 			log_inform("Receive OP_REQUEST_FILE_INFO");
+			uint64_t inicio = trace_now();
 
 			char *file_request;
 			serial_unpack(packet.content, "s", &file_request);
@@ -229,6 +244,7 @@ static void yama_handler(t_socket yama_socket) {
 				log_inform("Send OP_ARCHIVO_NODES");
 			}
 
+			trace_span("info_archivo", inicio, trace_now(), "%s", file_request);
 			free(file_request);
 		} else {
 			serial_destroy(packet.content);
@@ -251,10 +267,15 @@ static void datanode_handler(t_node *node) {
 			else break;
 		}
 
-		t_serial *serial = serial_pack("ii", op->blockno, op->opcode == NODE_SEND);
-		t_packet packet = protocol_packet(OP_REQUEST_BLOCK, serial);
+		trace_set(op->trace);
+		uint64_t inicio = metrics_now();
+		uint64_t inicioTraza = trace_now();
+		// El pedido tiene tamaño fijo: se arma en la pila, sin reservar memoria
+		t_layout_request_block request = {op->blockno, op->opcode == NODE_SEND};
+		unsigned char buffer[sizeof request];
+		t_serial serial = {buffer, layout_request_block_write(&request, buffer)};
+		t_packet packet = protocol_packet(OP_REQUEST_BLOCK, &serial);
 		protocol_send_packet(packet, node->socket);
-		serial_destroy(serial);
 
 		if(op->opcode == NODE_SEND) {
 			log_inform("Enviando bloque %d a nodo %s por socket %d", op->blockno, node->name, node->socket);
@@ -262,16 +283,25 @@ static void datanode_handler(t_node *node) {
 			packet = protocol_packet(OP_SEND_BLOCK, block);
 			protocol_send_packet(packet, node->socket);
 			free(block);
+			metrics_since(metrics_histogram("fs_bloque_envio_us{nodo=\"%s\"}", node->name), inicio);
+			trace_span("envio_bloque", inicioTraza, trace_now(), "%s: bloque %d", node->name, op->blockno);
 			filetable_sentblock();
 		} else {
 			log_inform("Recibiendo bloque %d de nodo %s", op->blockno, node->name);
 			packet = protocol_receive_packet(node->socket);
+			if(packet.operation == OP_SEND_BLOCK) {
+				metrics_since(metrics_histogram("fs_bloque_recepcion_us{nodo=\"%s\"}", node->name), inicio);
+				trace_span("recepcion_bloque", inicioTraza, trace_now(), "%s: bloque %d", node->name, op->blockno);
+			}
 			if(packet.operation != OP_SEND_BLOCK) {
 				log_report("Se esperaba recibir un bloque pero se recibió otra cosa");
 			} else if(op->opcode == NODE_RECV) {
 				filetable_writeblock(node->name, op->blockno, packet.content->data);
 			} else if(op->opcode == NODE_RECV_BLOCK) {
-				thread_respond((void*)packet.content->data);
+				// El bloque sobrevive al paquete: su buffer vuelve al pool al destruirlo
+				void *block = malloc(BLOCK_SIZE);
+				memcpy(block, packet.content->data, BLOCK_SIZE);
+				thread_respond(block);
 			}
 			serial_destroy(packet.content);
 		}
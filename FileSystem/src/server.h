@@ -10,6 +10,7 @@ typedef struct {
 	int opcode;
 	int blockno;
 	void *block;
+	int trace;		// Job de quien pidió la operación, para las trazas
 } t_nodeop;
 
 t_socket yama_socket;
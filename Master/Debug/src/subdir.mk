@@ -6,18 +6,21 @@
 C_SRCS += \
 ../src/Master.c \
 ../src/connection.c \
+../src/executor.c \
 ../src/funcionesMaster.c \
 ../src/manejadores.c 
 
 OBJS += \
 ./src/Master.o \
 ./src/connection.o \
+./src/executor.o \
 ./src/funcionesMaster.o \
 ./src/manejadores.o 
 
 C_DEPS += \
 ./src/Master.d \
 ./src/connection.d \
+./src/executor.d \
 ./src/funcionesMaster.d \
 ./src/manejadores.d 
 
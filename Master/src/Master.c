@@ -11,14 +11,16 @@
 #include "manejadores.h"
 
 int IDJOB;
+int limite_nodo;
 
 int main(int argc, char *argv[]) {
 	if(argc < 5) {
 		puts("Faltan argumentos");
+		puts("Uso: Master transformador reductor origen destino [--combinar] [--comprimir=lz4|zstd] [--peso=N]");
 		return EXIT_SUCCESS;
 	}
 
-	init(argv);
+	init(argc, argv);
 
 	hilo_node_drop = thread_create(node_drop, NULL);
 
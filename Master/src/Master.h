@@ -8,12 +8,13 @@
 #include <thread.h>
 #include <mtime.h>
 
-enum {TRANSFORMACION, REDUCCION_LOCAL, REDUCCION_GLOBAL, ALMACENAMIENTO};
+enum {TRANSFORMACION, REDUCCION_LOCAL, REDUCCION_GLOBAL, ALMACENAMIENTO, APAREO};
 
 typedef struct{
 	thread_t* hilo;
 	char* nodo;
 	int etapa;
+	int tareas;
 	bool active;
 	int result;
 } t_hilos;
@@ -23,6 +24,9 @@ struct{
 	char* path_reduc;
 	char* arch;
 	char* arch_result;
+	bool combinar;
+	char* compresion; // Códec de los archivos intermedios ("" si no se comprimen)
+	int peso; // Peso del job en el reparto de nodos entre jobs concurrentes
 } job;
 
 struct{
@@ -30,14 +34,16 @@ struct{
 	char* script_transf;
 	t_file* fd_reduc;
 	char* script_reduc;
+	char* md5_transf;
+	char* md5_reduc;
 } script;
 
 bool job_active;
 mlist_t* hilos;
 pthread_mutex_t mutex_hilos;
-sem_t* sem;
 thread_t* hilo_node_drop;
 extern int IDJOB;
+extern int limite_nodo; // Transformaciones en curso por nodo que admite YAMA (0 sin límite)
 
 struct{
 	int transf;
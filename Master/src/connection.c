@@ -2,11 +2,28 @@
 
 #include <config.h>
 #include <log.h>
+#include <mstring.h>
+#include <poll.h>
 #include <protocol.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <trace.h>
 
 #include "Master.h"
 
+#define INACTIVIDAD_MAXIMA 30000	// ms que una conexión puede quedar sin uso antes de cerrarla
+
+typedef struct {
+	char *address;
+	t_socket socket;
+	mtime_t since;
+} t_idle;
+
+// Conexiones a Workers que terminaron su tarea y pueden reutilizarse
+static mlist_t *idle = NULL;
+static pthread_mutex_t mutex_idle = PTHREAD_MUTEX_INITIALIZER;
+
+
 void connect_to_yama() {
 	const char *ip = config_get("YAMA_IP");
 	const char *port = config_get("YAMA_PUERTO");
@@ -21,22 +38,28 @@ void connect_to_yama() {
 	log_print("Conectado a YAMA en %s:%s por el socket %i", ip, port, socket);
 	t_packet packet = protocol_receive_packet(socket);
 	if(packet.operation == OP_IDJOB){
-		serial_unpack(packet.content,"i",&IDJOB);
-
+		serial_unpack(packet.content,"ii",&IDJOB,&limite_nodo);
+		// Desde acá todo lo que manda Master lleva el job como contexto de traza
+		trace_job(IDJOB);
 	}
 	yama_socket = socket;
 }
 
 void request_job_for_file(const char *file) {
-	log_print("Solicitud de job a YAMA");
-	t_serial *content = serial_pack("is",IDJOB ,file);
+	log_print("Solicitud de job a YAMA%s%s%s", job.combinar ? " (con combinador)" : "",
+			mstring_isempty(job.compresion) ? "" : ", compresión ", job.compresion);
+	t_serial *content = serial_pack("isisi",IDJOB ,file, job.combinar, job.compresion, job.peso);
 	t_packet packet = protocol_packet(OP_INIT_JOB, content);
 	protocol_send_packet(packet, yama_socket);
 	serial_destroy(content);
 }
 
 t_socket connect_to_worker(const char *ip, const char *port) { // La ip y el puerto son obtenidos mediante YAMA
-	t_socket socket = socket_connect(ip, port);
+	t_socket socket = reuse_worker(ip, port);
+	if(socket != -1) return socket;
+
+	uint64_t inicio = trace_now();
+	socket = socket_connect(ip, port);
 	if(!thread_active()) thread_exit(NULL);
 	if(socket == -1) {
 		log_report("Worker no está corriendo en %s:%s", ip, port);
@@ -44,6 +67,93 @@ t_socket connect_to_worker(const char *ip, const char *port) { // La ip y el pue
 		protocol_send_handshake(socket);
 		log_print("Conectado a Worker en %s:%s por el socket %i", ip, port, socket);
 	}
+	trace_span("conexion", inicio, trace_now(), "Worker %s:%s%s", ip, port, socket == -1 ? " (falló)" : "");
 	return socket;
 
 }
+
+t_packet receive_worker_packet(t_socket socket) {
+	while(true) {
+		t_packet packet = protocol_receive_packet(socket);
+		if(!thread_active()) thread_exit(NULL);
+		if(packet.operation != OP_SCRIPT_REQUEST) return packet;
+
+		t_serial *serial = pack_script(packet.content, socket);
+		protocol_send_packet(protocol_packet(OP_SCRIPT, serial), socket);
+		serial_destroy(serial);
+	}
+}
+
+t_serial *pack_script(t_serial *request, t_socket socket) {
+	char *md5;
+	serial_unpack(request, "s", &md5);
+	const char *content = "";
+	if(mstring_equal(md5, script.md5_transf)) content = script.script_transf;
+	else if(mstring_equal(md5, script.md5_reduc)) content = script.script_reduc;
+	log_print("Worker en socket %i solicita el script %s", socket, md5);
+	free(md5);
+	return serial_pack("s", content);
+}
+
+int receive_worker_response(t_socket socket) {
+	t_packet packet = receive_worker_packet(socket);
+	int code = -1;
+	if(packet.operation == OP_RESPONSE)
+		serial_unpack(packet.content, "i", &code);
+	else
+		serial_destroy(packet.content);
+	return code;
+}
+
+void release_worker(t_socket socket, const char *ip, const char *port, bool reusable) {
+	if(socket == -1) return;
+	if(!reusable) {
+		socket_close(socket);
+		log_print("Conexión a Worker en %s:%s por el socket %i cerrada", ip, port, socket);
+		return;
+	}
+
+	t_idle *conn = malloc(sizeof(t_idle));
+	conn->address = mstring_create("%s:%s", ip, port);
+	conn->socket = socket;
+	conn->since = mtime_now();
+	pthread_mutex_lock(&mutex_idle);
+	if(idle == NULL) idle = mlist_create();
+	mlist_append(idle, conn);
+	pthread_mutex_unlock(&mutex_idle);
+}
+
+void close_worker_connections() {
+	void close_idle(t_idle *conn) {
+		socket_close(conn->socket);
+		free(conn->address);
+		free(conn);
+	}
+	pthread_mutex_lock(&mutex_idle);
+	if(idle != NULL) mlist_clear(idle, close_idle);
+	pthread_mutex_unlock(&mutex_idle);
+}
+
+t_socket reuse_worker(const char *ip, const char *port) {
+	char *address = mstring_create("%s:%s", ip, port);
+	bool same_address(t_idle *conn) {
+		return mstring_equal(conn->address, address);
+	}
+	t_socket socket = -1;
+	pthread_mutex_lock(&mutex_idle);
+	int index;
+	while(socket == -1 && idle != NULL && (index = mlist_index(idle, same_address)) != -1) {
+		t_idle *conn = mlist_pop(idle, index);
+		// Una conexión sin tarea no debe tener nada para leer: si lo tiene, el Worker la cerró
+		struct pollfd fd = {conn->socket, POLLIN, 0};
+		bool alive = mtime_now() - conn->since < INACTIVIDAD_MAXIMA && poll(&fd, 1, 0) == 0;
+		if(alive) socket = conn->socket;
+		else socket_close(conn->socket);
+		free(conn->address);
+		free(conn);
+	}
+	pthread_mutex_unlock(&mutex_idle);
+	free(address);
+	if(socket != -1) log_print("Se reutiliza la conexión a Worker en %s:%s por el socket %i", ip, port, socket);
+	return socket;
+}
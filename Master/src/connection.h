@@ -1,12 +1,56 @@
 #ifndef CONNECTION_H_
 #define CONNECTION_H_
 
+#include <protocol.h>
 #include <socket.h>
+#include <stdbool.h>
 
 void connect_to_yama(void);
 
 void request_job_for_file(const char *file);
 
+/**
+ * Devuelve una conexión a un Worker, reutilizando una libre si la hay.
+ * @param ip IP del Worker.
+ * @param port Puerto del Worker.
+ * @return Socket conectado (con handshake hecho), o -1 si no se pudo conectar.
+ */
 t_socket connect_to_worker(const char *ip, const char *port);
 
+/**
+ * Devuelve una conexión libre a un Worker, sin conectarse si no la hay.
+ * @param ip IP del Worker.
+ * @param port Puerto del Worker.
+ * @return Socket conectado (con handshake hecho), o -1 si no hay ninguna libre.
+ */
+t_socket reuse_worker(const char *ip, const char *port);
+
+/**
+ * Libera una conexión obtenida con connect_to_worker.
+ * Solo se reutiliza si la última tarea terminó con una respuesta completa;
+ * si no, el flujo puede haber quedado a medias y se cierra.
+ * @param socket Socket de la conexión (-1 se ignora).
+ * @param ip IP del Worker.
+ * @param port Puerto del Worker.
+ * @param reusable Si la conexión puede usarse para otra tarea.
+ */
+void release_worker(t_socket socket, const char *ip, const char *port, bool reusable);
+
+/**
+ * Cierra todas las conexiones libres a Workers.
+ */
+void close_worker_connections(void);
+
+t_packet receive_worker_packet(t_socket socket);
+
+/**
+ * Arma la respuesta a un pedido de script de un Worker.
+ * @param request Contenido del pedido (se libera).
+ * @param socket Socket del Worker, para el log.
+ * @return Contenido del paquete OP_SCRIPT.
+ */
+t_serial *pack_script(t_serial *request, t_socket socket);
+
+int receive_worker_response(t_socket socket);
+
 #endif /* CONNECTION_H_ */
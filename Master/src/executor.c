@@ -0,0 +1,656 @@
+#include "executor.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <layout.h>
+#include <log.h>
+#include <mstring.h>
+#include <protocol.h>
+#include <struct.h>
+#include <thread.h>
+#include <trace.h>
+
+#include "Master.h"
+#include "connection.h"
+#include "funcionesMaster.h"
+
+#define EVENTOS 64
+#define ESPERA 500		// ms entre revisiones de las conexiones que no terminan de establecerse
+
+typedef struct {
+	char *nodo;
+	char *ip;
+	char *puerto;
+	mlist_t *pendientes;	// tEtapaTransformacion que todavía no se mandaron
+	int enCurso;			// Bloques mandados al Worker y no terminados
+} t_nodo;
+
+typedef enum {
+	CONECTANDO,		// connect en curso: se espera a poder escribir en el socket
+	ESPERANDO,		// Lote mandado, falta que el Worker lo acepte
+	CONFIRMADO		// El Worker aceptó el lote (desde ahí acepta cancelaciones)
+} t_estado;
+
+typedef struct {
+	t_socket socket;
+	t_nodo *nodo;
+	mlist_t *etapas;		// tEtapaTransformacion que el Worker está transformando
+	t_estado estado;
+	t_hilos *registro;		// Entrada en la lista de hilos, para las métricas del job
+	int bloques;			// Tamaño del lote, para la traza
+	uint64_t inicio;
+	mtime_t conexion;		// Inicio del connect, para cortarlo si el Worker no responde
+	// Paquete que se está recibiendo: primero el encabezado y después el contenido
+	char encabezado[LAYOUT_HEADER_SIZE];
+	t_packet entrante;		// Sin contenido mientras se lee el encabezado
+	size_t leidos;
+	// Lo que el socket todavía no aceptó
+	char *salida;
+	size_t pendientes;
+	size_t enviados;
+	bool esperandoSalida;	// Si está registrado EPOLLOUT
+} t_conexion;
+
+typedef enum {
+	CMD_ENCOLAR,
+	CMD_CANCELAR,
+	CMD_DESCARTAR,
+	CMD_TERMINAR
+} t_tipo;
+
+typedef struct {
+	t_tipo tipo;
+	mlist_t *etapas;
+	char *nodo;
+	int bloque;
+} t_comando;
+
+// Lo único compartido con los demás hilos es la cola de comandos: los nodos y
+// las conexiones son del hilo del despachador, que nunca bloquea en un socket
+static mutex_t *mutex = NULL;
+static mlist_t *comandos = NULL;
+static int aviso = -1;				// eventfd con el que se despierta al despachador
+static thread_t *despachador = NULL;
+
+static mlist_t *nodos = NULL;
+static mlist_t *conexiones = NULL;
+static int epoll_fd = -1;
+static int limite = 0;
+static bool activo = false;
+
+static void post(t_comando *comando);
+static void run_loop(void);
+static void run_commands(void);
+static void submit(mlist_t *etapas);
+static void cancel(const char *nodo, int bloque);
+static void check_timeouts(void);
+static bool connected(t_conexion *conexion);
+static bool receive(t_conexion *conexion);
+static bool handle(t_conexion *conexion, t_packet packet);
+static bool send_packet(t_conexion *conexion, t_operation operation, t_serial *content);
+static bool flush(t_conexion *conexion);
+static t_conexion *find_conexion(t_socket socket);
+static t_nodo *find_nodo(tEtapaTransformacion *etapa);
+static void dispatch(t_nodo *nodo);
+static void open_lote(t_nodo *nodo, mlist_t *etapas);
+static bool extend_lote(t_conexion *conexion, mlist_t *etapas);
+static t_serial *pack_lote(t_serial *serial, mlist_t *etapas);
+static bool is_open(t_conexion *conexion);
+static bool finish_etapa(t_conexion *conexion, tEtapaTransformacion *etapa);
+static void fail(t_conexion *conexion, tEtapaTransformacion *fallida);
+static void drop_nodo(t_nodo *nodo);
+static void close_conexion(t_conexion *conexion, int response);
+static void etapa_destroy(tEtapaTransformacion *etapa);
+
+// ========== Funciones públicas ==========
+
+void executor_init(int limite_nodo) {
+	mutex = thread_mutex_create();
+	comandos = mlist_create();
+	nodos = mlist_create();
+	conexiones = mlist_create();
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	aviso = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	struct epoll_event event = {.events = EPOLLIN, .data.fd = aviso};
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, aviso, &event);
+	limite = limite_nodo > 0 ? limite_nodo : 0;
+	activo = true;
+	if(limite > 0) log_print("Despachador con hasta %d transformaciones por nodo", limite);
+	despachador = thread_create(run_loop, NULL);
+}
+
+void executor_submit(mlist_t *etapas) {
+	t_comando *comando = calloc(1, sizeof(t_comando));
+	comando->tipo = CMD_ENCOLAR;
+	comando->etapas = mlist_create();
+	void copiar(tEtapaTransformacion *etapa) {
+		mlist_append(comando->etapas, etapa);
+	}
+	mlist_traverse(etapas, copiar);
+	post(comando);
+}
+
+void executor_cancel(const char *nodo, int bloque) {
+	t_comando *comando = calloc(1, sizeof(t_comando));
+	comando->tipo = CMD_CANCELAR;
+	comando->nodo = mstring_duplicate(nodo);
+	comando->bloque = bloque;
+	post(comando);
+}
+
+void executor_drop(const char *nodo) {
+	t_comando *comando = calloc(1, sizeof(t_comando));
+	comando->tipo = CMD_DESCARTAR;
+	comando->nodo = mstring_duplicate(nodo);
+	post(comando);
+}
+
+void executor_terminate() {
+	if(despachador == NULL) return;
+	t_comando *comando = calloc(1, sizeof(t_comando));
+	comando->tipo = CMD_TERMINAR;
+	post(comando);
+	thread_wait(despachador);
+	despachador = NULL;
+}
+
+// ========== Funciones privadas ==========
+
+static void post(t_comando *comando) {
+	thread_mutex_lock(mutex);
+	mlist_append(comandos, comando);
+	thread_mutex_unlock(mutex);
+	uint64_t uno = 1;
+	ssize_t escritos = write(aviso, &uno, sizeof uno);
+	(void) escritos;
+}
+
+static void run_loop() {
+	struct epoll_event events[EVENTOS];
+	while(activo) {
+		int n = epoll_wait(epoll_fd, events, EVENTOS, ESPERA);
+		if(n == -1 && errno != EINTR) {
+			log_report("Falló la espera del despachador de transformaciones");
+			break;
+		}
+
+		for(int i = 0; i < n && activo; i++) {
+			if(events[i].data.fd == aviso) {
+				run_commands();
+				continue;
+			}
+			// Se busca por socket: la conexión pudo cerrarse al atender otro evento
+			t_conexion *conexion = find_conexion(events[i].data.fd);
+			if(conexion == NULL) continue;
+			uint32_t ocurrido = events[i].events;
+			if(conexion->estado == CONECTANDO) {
+				if(!connected(conexion)) continue;
+			} else if((ocurrido & EPOLLOUT) && !flush(conexion)) {
+				fail(conexion, NULL);
+				continue;
+			}
+			if(ocurrido & (EPOLLIN | EPOLLHUP | EPOLLERR)) receive(conexion);
+		}
+		check_timeouts();
+	}
+
+	while(!mlist_empty(conexiones)) {
+		close_conexion(mlist_first(conexiones), -1);
+	}
+	thread_exit(0);
+}
+
+static void run_commands() {
+	uint64_t avisos;
+	ssize_t leidos = read(aviso, &avisos, sizeof avisos);
+	(void) leidos;
+
+	thread_mutex_lock(mutex);
+	mlist_t *pendientes = comandos;
+	comandos = mlist_create();
+	thread_mutex_unlock(mutex);
+
+	void ejecutar(t_comando *comando) {
+		bool esNodo(t_nodo *candidato) {
+			return mstring_equali(candidato->nodo, comando->nodo);
+		}
+		t_nodo *caido;
+		switch(comando->tipo) {
+		case CMD_ENCOLAR:
+			submit(comando->etapas);
+			mlist_destroy(comando->etapas, NULL);
+			break;
+		case CMD_CANCELAR:
+			cancel(comando->nodo, comando->bloque);
+			break;
+		case CMD_DESCARTAR:
+			if((caido = mlist_find(nodos, esNodo)) != NULL) drop_nodo(caido);
+			break;
+		case CMD_TERMINAR:
+			activo = false;
+			break;
+		}
+		free(comando->nodo);
+		free(comando);
+	}
+	mlist_destroy(pendientes, ejecutar);
+}
+
+static void submit(mlist_t *etapas) {
+	mlist_t *tocados = mlist_create();
+	void encolar(tEtapaTransformacion *etapa) {
+		t_nodo *nodo = find_nodo(etapa);
+		mlist_append(nodo->pendientes, etapa);
+		bool esNodo(t_nodo *otro) {
+			return otro == nodo;
+		}
+		if(!mlist_any(tocados, esNodo)) mlist_append(tocados, nodo);
+	}
+	mlist_traverse(etapas, encolar);
+	mlist_traverse(tocados, dispatch);
+	mlist_destroy(tocados, NULL);
+}
+
+static void cancel(const char *nodo, int bloque) {
+	bool esBloque(tEtapaTransformacion *etapa) {
+		return etapa->bloque == bloque && mstring_equal(etapa->nodo, nodo);
+	}
+	bool tieneBloque(t_conexion *conexion) {
+		return conexion->estado == CONFIRMADO && mlist_any(conexion->etapas, esBloque);
+	}
+	bool esNodo(t_nodo *candidato) {
+		return mstring_equal(candidato->nodo, nodo);
+	}
+
+	t_conexion *conexion = mlist_find(conexiones, tieneBloque);
+	t_nodo *pendiente = mlist_find(nodos, esNodo);
+	tEtapaTransformacion *etapa = pendiente == NULL ? NULL : mlist_remove(pendiente->pendientes, esBloque, NULL);
+	if(conexion != NULL) {
+		log_inform("Envío a %s socket %d OP_CANCELAR_TRANSFORMACION del bloque %d",
+				nodo, conexion->socket, bloque);
+		if(!send_packet(conexion, OP_CANCELAR_TRANSFORMACION, serial_pack("i", bloque))) fail(conexion, NULL);
+	} else if(etapa != NULL) {
+		log_print("Bloque %d de %s cancelado antes de mandarse", bloque, nodo);
+		etapa_destroy(etapa);
+	} else {
+		log_print("Bloque %d de %s sin lote activo para cancelar", bloque, nodo);
+	}
+}
+
+static void check_timeouts() {
+	int espera = socket_connect_timeout();
+	if(espera <= 0) return;
+	bool vencida(t_conexion *conexion) {
+		return conexion->estado == CONECTANDO && mtime_now() - conexion->conexion >= (mtime_t) espera;
+	}
+	t_conexion *conexion;
+	while((conexion = mlist_find(conexiones, vencida)) != NULL) {
+		log_report("Worker en %s:%s no respondió a tiempo", conexion->nodo->ip, conexion->nodo->puerto);
+		fail(conexion, NULL);
+	}
+}
+
+static bool connected(t_conexion *conexion) {
+	int error = socket_connect_result(conexion->socket);
+	t_nodo *nodo = conexion->nodo;
+	trace_span("conexion", conexion->inicio, trace_now(), "Worker %s:%s%s", nodo->ip, nodo->puerto, error != 0 ? " (falló)" : "");
+	if(error != 0) {
+		log_report("Worker no está corriendo en %s:%s", nodo->ip, nodo->puerto);
+		fail(conexion, NULL);
+		return false;
+	}
+
+	log_print("Conectado a Worker en %s:%s por el socket %i", nodo->ip, nodo->puerto, conexion->socket);
+	conexion->estado = ESPERANDO;
+	if(!flush(conexion)) {
+		fail(conexion, NULL);
+		return false;
+	}
+	return true;
+}
+
+static bool receive(t_conexion *conexion) {
+	// Se lee lo que haya sin bloquear; un paquete puede completarse en varias vueltas
+	while(true) {
+		char *destino = conexion->entrante.content == NULL ? conexion->encabezado : conexion->entrante.content->data;
+		size_t total = conexion->entrante.content == NULL ? LAYOUT_HEADER_SIZE : conexion->entrante.content->size;
+		if(conexion->leidos < total) {
+			ssize_t n = recv(conexion->socket, destino + conexion->leidos, total - conexion->leidos, 0);
+			if(n == -1 && errno == EINTR) continue;
+			if(n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+			if(n <= 0) {
+				// El Worker cerró la conexión o se cayó
+				fail(conexion, NULL);
+				return false;
+			}
+			conexion->leidos += n;
+			if(conexion->leidos < total) continue;
+		}
+
+		if(conexion->entrante.content == NULL) {
+			t_layout_header header;
+			layout_header_read(&header, conexion->encabezado, LAYOUT_HEADER_SIZE);
+			t_serial *content = header.size > PROTOCOL_MAX_PACKET ? NULL : serial_create_pooled(header.size);
+			if(content == NULL || (header.size > 0 && content->data == NULL)) {
+				log_report("Paquete inválido del Worker en el socket %d", conexion->socket);
+				if(content != NULL) serial_destroy(content);
+				fail(conexion, NULL);
+				return false;
+			}
+			conexion->entrante = (t_packet) {header.sender, header.operation, header.trace, content};
+			conexion->leidos = 0;
+			if(header.size > 0) continue;
+		}
+
+		t_packet packet = conexion->entrante;
+		conexion->entrante.content = NULL;
+		conexion->leidos = 0;
+		if(!handle(conexion, packet)) return false;
+	}
+}
+
+static bool handle(t_conexion *conexion, t_packet packet) {
+	if(packet.operation == OP_SCRIPT_REQUEST) {
+		if(send_packet(conexion, OP_SCRIPT, pack_script(packet.content, conexion->socket))) return true;
+		fail(conexion, NULL);
+		return false;
+	}
+
+	if(conexion->estado == ESPERANDO) {
+		int code = -1;
+		if(packet.operation == OP_RESPONSE) serial_unpack(packet.content, "i", &code);
+		else serial_destroy(packet.content);
+		if(code != RESPONSE_OK) {
+			fail(conexion, NULL);
+			return false;
+		}
+		conexion->estado = CONFIRMADO;
+		// Lo que llegó mientras se esperaba la confirmación va al mismo lote
+		dispatch(conexion->nodo);
+		return is_open(conexion);
+	}
+
+	if(packet.operation != OP_BLOQUE_TRANSFORMADO) {
+		serial_destroy(packet.content);
+		fail(conexion, NULL);
+		return false;
+	}
+
+	int bloque, response, cola, duracion;
+	serial_unpack(packet.content, "iiii", &bloque, &response, &cola, &duracion);
+	bool esBloque(tEtapaTransformacion *etapa) {
+		return etapa->bloque == bloque;
+	}
+	tEtapaTransformacion *transformacion = mlist_find(conexion->etapas, esBloque);
+	if(transformacion == NULL || response != RESPONSE_OK) {
+		if(response == RESPONSE_CANCELADO && transformacion != NULL) {
+			// YAMA ya tiene el resultado de la otra copia
+			log_print("Bloque %d cancelado en %s", bloque, transformacion->nodo);
+			return finish_etapa(conexion, transformacion);
+		}
+		fail(conexion, transformacion);
+		return false;
+	}
+
+	log_print("Se manda bloque %d", transformacion->bloque);
+	t_layout_transformacion_lista lista = {
+			IDJOB,
+			transformacion->nodo,
+			transformacion->bloque,
+			response,
+			job.arch,
+			cola,
+			transformacion->bytes_ocupados,
+			duracion};
+	t_serial *serial_yama = layout_transformacion_lista_pack(&lista);
+	enviar_resultado_yama(OP_TRANSFORMACION_LISTA, serial_yama);
+	log_inform("Envío a YAMA socket %d OP_TRANSFORMACION_LISTA", yama_socket);
+	times.transf_end = mtime_now();
+	return finish_etapa(conexion, transformacion);
+}
+
+static bool send_packet(t_conexion *conexion, t_operation operation, t_serial *content) {
+	// El paquete se agrega a la salida y se manda lo que el socket acepte sin bloquear
+	size_t size = content == NULL ? 0 : content->size;
+	t_layout_header header = {process_current(), operation, trace_current(), size};
+	conexion->salida = realloc(conexion->salida, conexion->pendientes + LAYOUT_HEADER_SIZE + size);
+	layout_header_write(&header, conexion->salida + conexion->pendientes);
+	if(size > 0) memcpy(conexion->salida + conexion->pendientes + LAYOUT_HEADER_SIZE, content->data, size);
+	conexion->pendientes += LAYOUT_HEADER_SIZE + size;
+	if(content != NULL) serial_destroy(content);
+	return conexion->estado == CONECTANDO || flush(conexion);
+}
+
+static bool flush(t_conexion *conexion) {
+	while(conexion->enviados < conexion->pendientes) {
+		ssize_t n = send(conexion->socket, conexion->salida + conexion->enviados,
+				conexion->pendientes - conexion->enviados, MSG_NOSIGNAL);
+		if(n == -1 && errno == EINTR) continue;
+		if(n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+		if(n <= 0) return false;
+		conexion->enviados += n;
+	}
+	if(conexion->enviados == conexion->pendientes) conexion->enviados = conexion->pendientes = 0;
+
+	// EPOLLOUT solo mientras quede algo por mandar
+	bool esperar = conexion->pendientes > 0;
+	if(esperar != conexion->esperandoSalida) {
+		struct epoll_event event = {.events = EPOLLIN | (esperar ? EPOLLOUT : 0), .data.fd = conexion->socket};
+		epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conexion->socket, &event);
+		conexion->esperandoSalida = esperar;
+	}
+	return true;
+}
+
+static t_conexion *find_conexion(t_socket socket) {
+	bool esSocket(t_conexion *conexion) {
+		return conexion->socket == socket;
+	}
+	return mlist_find(conexiones, esSocket);
+}
+
+static t_nodo *find_nodo(tEtapaTransformacion *etapa) {
+	bool esNodo(t_nodo *nodo) {
+		return mstring_equal(nodo->nodo, etapa->nodo);
+	}
+	t_nodo *nodo = mlist_find(nodos, esNodo);
+	if(nodo == NULL) {
+		nodo = malloc(sizeof(t_nodo));
+		nodo->nodo = mstring_duplicate(etapa->nodo);
+		nodo->ip = mstring_duplicate(etapa->ip);
+		nodo->puerto = mstring_duplicate(etapa->puerto);
+		nodo->pendientes = mlist_create();
+		nodo->enCurso = 0;
+		mlist_append(nodos, nodo);
+	}
+	return nodo;
+}
+
+static void dispatch(t_nodo *nodo) {
+	// Un solo lote por nodo: lo que entra se agrega al lote abierto en lugar de abrir otro
+	bool esDelNodo(t_conexion *conexion) {
+		return conexion->nodo == nodo;
+	}
+	t_conexion *conexion = mlist_find(conexiones, esDelNodo);
+	if(conexion != NULL && conexion->estado != CONFIRMADO) return;	// Se despacha al confirmarse
+	if(mlist_empty(nodo->pendientes) || (limite > 0 && nodo->enCurso >= limite)) return;
+
+	int cantidad = mlist_length(nodo->pendientes);
+	if(limite > 0 && cantidad > limite - nodo->enCurso) cantidad = limite - nodo->enCurso;
+	mlist_t *etapas = mlist_create();
+	for(int i = 0; i < cantidad; i++) {
+		mlist_append(etapas, mlist_pop(nodo->pendientes, 0));
+	}
+	if(conexion == NULL) open_lote(nodo, etapas);
+	else if(!extend_lote(conexion, etapas)) fail(conexion, NULL);
+}
+
+static void open_lote(t_nodo *nodo, mlist_t *etapas) {
+	t_conexion *conexion = calloc(1, sizeof(t_conexion));
+	conexion->nodo = nodo;
+	conexion->etapas = etapas;
+	conexion->bloques = mlist_length(etapas);
+	conexion->inicio = trace_now();
+	conexion->conexion = mtime_now();
+	conexion->registro = set_hilo(TRANSFORMACION, nodo->nodo);
+	conexion->registro->hilo = NULL;
+	conexion->registro->tareas = mlist_length(etapas);
+	nodo->enCurso += mlist_length(etapas);
+	mlist_append(conexiones, conexion);
+
+	pthread_mutex_lock(&mutex_hilos);
+	mlist_append(hilos, conexion->registro);
+	verificarParalelismo(TRANSFORMACION);
+	pthread_mutex_unlock(&mutex_hilos);
+
+	log_print("Lote de %d bloques para %s", mlist_length(etapas), nodo->nodo);
+	// Una conexión libre ya hizo el handshake; si no hay, se conecta sin esperar al Worker
+	conexion->socket = reuse_worker(nodo->ip, nodo->puerto);
+	conexion->estado = conexion->socket == -1 ? CONECTANDO : ESPERANDO;
+	if(conexion->socket == -1) conexion->socket = socket_connect_async(nodo->ip, nodo->puerto, SOCKET_CONTROL);
+	else socket_set_blocking(conexion->socket, false);
+
+	struct epoll_event event = {.events = EPOLLIN | EPOLLOUT, .data.fd = conexion->socket};
+	conexion->esperandoSalida = true;
+	if(conexion->socket == -1 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conexion->socket, &event) == -1) {
+		log_report("Worker no está corriendo en %s:%s", nodo->ip, nodo->puerto);
+		fail(conexion, NULL);
+		return;
+	}
+
+	if(conexion->estado == CONECTANDO) send_packet(conexion, OP_HANDSHAKE, serial_pack("i", PROTOCOL_VERSION));
+	t_serial *serial_worker = serial_pack("ssii",
+			script.md5_transf,
+			job.combinar ? script.md5_reduc : "",
+			IDJOB,
+			mlist_length(etapas));
+	pack_lote(serial_worker, etapas);
+	log_inform("Envío a %s socket %d OP_INICIAR_TRANSFORMACION_LOTE", nodo->nodo, conexion->socket);
+	if(!send_packet(conexion, OP_INICIAR_TRANSFORMACION_LOTE, serial_worker)) fail(conexion, NULL);
+}
+
+static bool extend_lote(t_conexion *conexion, mlist_t *etapas) {
+	int cantidad = mlist_length(etapas);
+	t_serial *serial_worker = pack_lote(serial_pack("i", cantidad), etapas);
+	mlist_extend(conexion->etapas, etapas);
+	mlist_destroy(etapas, NULL);
+	conexion->bloques += cantidad;
+	conexion->nodo->enCurso += cantidad;
+	pthread_mutex_lock(&mutex_hilos);
+	conexion->registro->tareas += cantidad;
+	pthread_mutex_unlock(&mutex_hilos);
+
+	log_inform("Envío a %s socket %d OP_AMPLIAR_LOTE con %d bloques", conexion->nodo->nodo, conexion->socket, cantidad);
+	return send_packet(conexion, OP_AMPLIAR_LOTE, serial_worker);
+}
+
+static t_serial *pack_lote(t_serial *serial, mlist_t *etapas) {
+	void agregarBloque(tEtapaTransformacion *transformacion) {
+		serial_add(serial, "sii",
+				transformacion->archivo_etapa,
+				transformacion->bloque,
+				transformacion->bytes_ocupados);
+	}
+	mlist_traverse(etapas, agregarBloque);
+	return serial;
+}
+
+static bool is_open(t_conexion *conexion) {
+	bool esConexion(t_conexion *otra) {
+		return otra == conexion;
+	}
+	return mlist_any(conexiones, esConexion);
+}
+
+static bool finish_etapa(t_conexion *conexion, tEtapaTransformacion *etapa) {
+	bool esEtapa(tEtapaTransformacion *otra) {
+		return otra == etapa;
+	}
+	mlist_remove(conexion->etapas, esEtapa, etapa_destroy);
+	conexion->nodo->enCurso--;
+
+	// El lugar libre se llena con pendientes del nodo dentro del mismo lote
+	dispatch(conexion->nodo);
+	if(!is_open(conexion)) return false;
+	if(!mlist_empty(conexion->etapas)) return true;
+
+	// Sin nada más para el nodo, el Worker suelta el lote y la conexión queda libre
+	log_inform("Envío a %s socket %d OP_FIN_LOTE", conexion->nodo->nodo, conexion->socket);
+	send_packet(conexion, OP_FIN_LOTE, NULL);
+	close_conexion(conexion, RESPONSE_OK);
+	return false;
+}
+
+static void fail(t_conexion *conexion, tEtapaTransformacion *fallida) {
+	// Se informa una sola vez y YAMA replanifica todos los bloques del nodo
+	if(fallida == NULL) fallida = mlist_first(conexion->etapas);
+	log_report("Falló el lote de %s: se descartan sus transformaciones", conexion->nodo->nodo);
+	t_layout_transformacion_lista lista = {IDJOB, fallida->nodo, fallida->bloque, -1, job.arch, -1, 0, 0};
+	t_serial *serial_yama = layout_transformacion_lista_pack(&lista);
+	enviar_resultado_yama(OP_TRANSFORMACION_LISTA, serial_yama);
+	log_inform("Envío a YAMA socket %d OP_TRANSFORMACION_LISTA", yama_socket);
+
+	t_nodo *nodo = conexion->nodo;
+	close_conexion(conexion, -1);
+	drop_nodo(nodo);
+
+	// Las demás tareas del nodo (reducciones, apareos) tampoco van a terminar
+	pthread_mutex_lock(&mutex_hilos);
+	matar_hilos_nodo(nodo->nodo, NULL);
+	pthread_mutex_unlock(&mutex_hilos);
+}
+
+static void drop_nodo(t_nodo *nodo) {
+	bool esDelNodo(t_conexion *conexion) {
+		return conexion->nodo == nodo;
+	}
+	t_conexion *conexion;
+	while((conexion = mlist_find(conexiones, esDelNodo)) != NULL) {
+		close_conexion(conexion, -1);
+	}
+	mlist_clear(nodo->pendientes, etapa_destroy);
+	nodo->enCurso = 0;
+}
+
+static void close_conexion(t_conexion *conexion, int response) {
+	// Un lote completo deja la conexión lista para el siguiente, siempre que no quede nada a medio mandar
+	bool reutilizable = response == RESPONSE_OK && conexion->estado == CONFIRMADO
+			&& conexion->pendientes == 0 && conexion->entrante.content == NULL && conexion->leidos == 0;
+	if(conexion->socket != -1) {
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conexion->socket, NULL);
+		// Las demás tareas usan las conexiones libres en modo bloqueante
+		if(reutilizable) socket_set_blocking(conexion->socket, true);
+	}
+	release_worker(conexion->socket, conexion->nodo->ip, conexion->nodo->puerto, reutilizable);
+	conexion->nodo->enCurso -= mlist_length(conexion->etapas);
+	trace_span("lote_transformacion", conexion->inicio, trace_now(), "%s: %d bloques (respuesta %d)",
+			conexion->nodo->nodo, conexion->bloques, response);
+
+	pthread_mutex_lock(&mutex_hilos);
+	conexion->registro->active = false;
+	conexion->registro->result = response;
+	pthread_mutex_unlock(&mutex_hilos);
+
+	bool esConexion(t_conexion *otra) {
+		return otra == conexion;
+	}
+	mlist_remove(conexiones, esConexion, NULL);
+	mlist_destroy(conexion->etapas, etapa_destroy);
+	if(conexion->entrante.content != NULL) serial_destroy(conexion->entrante.content);
+	free(conexion->salida);
+	free(conexion);
+}
+
+static void etapa_destroy(tEtapaTransformacion *etapa) {
+	free(etapa->nodo);
+	free(etapa->ip);
+	free(etapa->puerto);
+	free(etapa->archivo_etapa);
+	free(etapa);
+}
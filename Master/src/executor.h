@@ -0,0 +1,43 @@
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+#include <mlist.h>
+
+/**
+ * Inicia el despachador de transformaciones.
+ * Un único hilo atiende con epoll las conexiones a todos los Workers, en
+ * lugar de un hilo bloqueado en cada socket. Las conexiones, los envíos y
+ * las lecturas nunca bloquean; las demás funciones solo encolan un pedido.
+ * @param limite Máximo de transformaciones en curso por nodo (0 para no limitar).
+ */
+void executor_init(int limite);
+
+/**
+ * Encola transformaciones para que se manden a sus Workers.
+ * Cada nodo tiene un solo lote abierto, que se amplía a medida que tiene lugar.
+ * @param etapas Lista de tEtapaTransformacion (el despachador se queda con los elementos,
+ *               la lista sigue siendo del llamador).
+ */
+void executor_submit(mlist_t *etapas);
+
+/**
+ * Cancela la transformación de un bloque porque otra copia ya terminó.
+ * Si el bloque todavía no se mandó, se descarta sin avisar al Worker.
+ * @param nodo Nodo que tiene asignado el bloque.
+ * @param bloque Número de bloque en el nodo.
+ */
+void executor_cancel(const char *nodo, int bloque);
+
+/**
+ * Descarta las transformaciones de un nodo caído sin informarlas a YAMA.
+ * @param nodo Nombre del nodo.
+ */
+void executor_drop(const char *nodo);
+
+/**
+ * Cierra las conexiones abiertas y detiene el despachador.
+ * Espera a que el hilo del despachador termine.
+ */
+void executor_terminate(void);
+
+#endif /* EXECUTOR_H_ */
@@ -4,7 +4,25 @@
 void kill_thread(t_hilos* hilo){
 	hilo->active = false;
 	thread_kill(hilo->hilo);
-	thread_sem_signal(sem);
+}
+
+void matar_hilos_nodo(const char* nodo, thread_t* excepto){
+	// Las transformaciones no tienen hilo propio: las descarta el despachador
+	bool getNodeDrop(t_hilos* hilo){
+		return hilo->active &&
+				hilo->hilo != NULL &&
+				mstring_equali(nodo, hilo->nodo) &&
+				hilo->hilo != excepto;
+	}
+	mlist_t* hilos_drop = mlist_filter(hilos, getNodeDrop);
+	mlist_traverse(hilos_drop, kill_thread);
+	for(int i = 0; i < mlist_length(hilos_drop); i++){
+		t_hilos* hilo_drop_node = mlist_get(hilos_drop, i);
+		log_report("Finalización del hilo %d por caída del nodo: %s",
+				hilo_drop_node->hilo,
+				hilo_drop_node->nodo);
+	}
+	mlist_destroy(hilos_drop, NULL);
 }
 
 void node_drop(){
@@ -15,24 +33,13 @@ void node_drop(){
 		}
 		pthread_mutex_lock(&mutex_hilos);
 		t_hilos* hilo_sender = mlist_find(hilos, getSender);
-		if(hilo_sender != NULL && hilo_sender->active && !mstring_isempty(data)){
-			bool getNodeDrop(t_hilos* hilo){
-				return hilo->active &&
-						mstring_equali(data, hilo->nodo) &&
-						hilo->hilo != hilo_sender->hilo;
-			}
-			mlist_t* hilos_drop = mlist_filter(hilos, getNodeDrop);
-			mlist_traverse(hilos_drop, kill_thread);
-			for(int i = 0; i < mlist_length(hilos_drop); i++){
-				t_hilos* hilo_drop_node = mlist_get(hilos_drop, i);
-				log_report("Finalización del hilo %d por caída del nodo: %s",
-						hilo_drop_node->hilo,
-						hilo_drop_node->nodo);
-			}
-
+		bool drop = hilo_sender != NULL && hilo_sender->active && !mstring_isempty(data);
+		if(drop){
+			matar_hilos_nodo(data, hilo_sender->hilo);
 			thread_resume(hilo_sender->hilo);
 		}
 		pthread_mutex_unlock(&mutex_hilos);
+		if(drop) executor_drop(data);
 	}
 	thread_exit(0);
 }
@@ -66,8 +73,12 @@ void response_worker(t_socket socket, int* response) {
 }
 
 bool enviar_resultado_yama(int operacion,t_serial* serial_yama) {
+	// Varios hilos reportan a YAMA por el mismo socket
+	static pthread_mutex_t mutex_yama = PTHREAD_MUTEX_INITIALIZER;
 	t_packet yama = protocol_packet(operacion, serial_yama);
+	pthread_mutex_lock(&mutex_yama);
 	bool result = protocol_send_packet(yama, yama_socket);
+	pthread_mutex_unlock(&mutex_yama);
 	serial_destroy(serial_yama);
 	return result;
 }
@@ -77,6 +88,7 @@ t_hilos* set_hilo(int etapa, char* nodo) {
 	t_hilos* hilo = malloc(sizeof(t_hilos));
 	hilo->etapa = etapa;
 	hilo->nodo = mstring_duplicate(nodo);
+	hilo->tareas = 1;
 	hilo->active = true;
 	hilo->result = -1;
 	return hilo;
@@ -90,6 +102,10 @@ void cargar_scripts(char* path_transf, char* path_reduc) {
 	 script.fd_reduc = file_open(path_reduc);
 	 script.script_reduc = file_map(script.fd_reduc);
 
+	 // Los Workers reciben solo el hash y piden el contenido si no lo tienen
+	 script.md5_transf = path_md5(path_transf);
+	 script.md5_reduc = path_md5(path_reduc);
+
 }
 
 void liberar_scripts() {
@@ -98,16 +114,19 @@ void liberar_scripts() {
 	file_unmap(script.fd_reduc, script.script_reduc);
 	file_close(script.fd_transf);
 	file_close(script.fd_reduc);
+	free(script.md5_transf);
+	free(script.md5_reduc);
 }
 
 const char *timeprom(mtime_t t1, mtime_t t2, int etapa){
-	bool getEtapa(t_hilos* hilo){
-		return (hilo->etapa == etapa);
+	int getEtapa(int total, t_hilos* hilo){
+		return total + (hilo->etapa == etapa ? hilo->tareas : 0);
 	}
-	if(mlist_count(hilos, getEtapa) == 0){
+	int tareas = mlist_reduce(hilos, getEtapa);
+	if(tareas == 0){
 		return string_from_format("%02u:%02u:%02u:%03u", 0, 0, 0, 0);
 	}else{
-		mtime_t duration = abs(((int) mtime_diff(t1, t2)) / mlist_count(hilos, getEtapa));
+		mtime_t duration = abs(((int) mtime_diff(t1, t2)) / tareas);
 		return mtime_formatted(duration, MTIME_DIFF | MTIME_PRECISE);
 	}
 }
@@ -121,7 +140,10 @@ void verificarParalelismo(int etapa){
 	}
 	int total;
 	if (etapa == TRANSFORMACION){
-		total = mlist_count(hilos, statusEtapaTransformacion);
+		int tareasActivas(int total, t_hilos* hilo){
+			return total + (statusEtapaTransformacion(hilo) ? hilo->tareas : 0);
+		}
+		total = mlist_reduce(hilos, tareasActivas);
 		if (total > tareasParalelo.transf) tareasParalelo.transf = total;
 	}else if (etapa == REDUCCION_LOCAL){
 		total = mlist_count(hilos, statusEtapaReduccionLocal);
@@ -140,6 +162,9 @@ void calcular_metricas(){
 	bool getReduccionGlobal(t_hilos* hilo){
 		return (hilo->etapa == REDUCCION_GLOBAL);
 	}
+	int sumarTransformaciones(int total, t_hilos* hilo){
+		return total + (getTransformacion(hilo) ? hilo->tareas : 0);
+	}
 
 	printf("Tiempo total de ejecución del Job: %s\n",
 			mtime_formatted(mtime_diff(times.job_init, times.job_end), MTIME_DIFF | MTIME_PRECISE));
@@ -158,7 +183,7 @@ void calcular_metricas(){
 			"Transformaciones: %d\n"
 			"Reducciones Locales: %d\n"
 			"Reducciones Globales: %d\n",
-			mlist_count(hilos, getTransformacion),
+			mlist_reduce(hilos, sumarTransformaciones),
 			mlist_count(hilos, getReduccionLocal),
 			mlist_count(hilos, getReduccionGlobal));
 	bool getFallos(t_hilos* hilo){
@@ -167,33 +192,49 @@ void calcular_metricas(){
 	printf("Cantidad de fallos del job: %d\n", mlist_count(hilos, getFallos));
 }
 
-void init(char* argv[]){
+void init(int argc, char* argv[]){
 	times.job_init = times.job_end = mtime_now();
 
 	job.path_transf = string_duplicate(argv[1]);
 	job.path_reduc = string_duplicate(argv[2]);
 	job.arch = string_duplicate(argv[3]);
 	job.arch_result = string_duplicate(argv[4]);
+	// El reductor solo puede usarse como combinador si el job lo declara asociativo;
+	// la compresión (lz4 o zstd) se aplica a los archivos intermedios del job
+	// El peso define qué parte de los nodos le toca al job cuando YAMA atiende varios a la vez
+	job.combinar = false;
+	job.compresion = "";
+	job.peso = 1;
+	for(int i = 5; i < argc; i++){
+		if(mstring_equal(argv[i], "--combinar")) job.combinar = true;
+		else if(mstring_hasprefix(argv[i], "--comprimir=")) job.compresion = argv[i] + strlen("--comprimir=");
+		else if(mstring_hasprefix(argv[i], "--peso=")) job.peso = atoi(argv[i] + strlen("--peso="));
+	}
 	cargar_scripts(job.path_transf, job.path_reduc);
 
 	thread_init();
 	hilos = mlist_create();
 	pthread_mutex_init(&mutex_hilos, NULL);
-	sem = thread_sem_create(30);
 	tareasParalelo.transf = 0;
 	tareasParalelo.reducc = 0;
 
 	process_init();
 	connect_to_yama();
+	executor_init(limite_nodo);
 	request_job_for_file(job.arch);
 	job_active = true;
 }
 
 void terminate() {
+	// El despachador todavía usa mutex_hilos al cerrar sus lotes
+	executor_terminate();
 	pthread_mutex_destroy(&mutex_hilos);
+	close_worker_connections();
 	liberar_scripts();
 	socket_close(yama_socket);
 	log_print("Conexión a YAMA por el socket %i cerrada", yama_socket);
+	// El tramo del job entero enmarca al resto en la traza
+	trace_span("job", times.job_init * 1000, times.job_end * 1000, "%s -> %s", job.arch, job.arch_result);
 	calcular_metricas();
 	void hilo_destroy(t_hilos *self){
 		free(self);
@@ -7,6 +7,7 @@
 #include "manejadores.h"
 #include <file.h>
 #include <mtime.h>
+#include <path.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -17,6 +18,8 @@
 
 void kill_thread(t_hilos*);
 
+void matar_hilos_nodo(const char*, thread_t*);
+
 void node_drop();
 
 void actualizar_hilo(int);
@@ -43,7 +46,7 @@ const char *timediff(time_t, time_t);
 
 void verificarParalelismo(int);
 
-void init(char*[]);
+void init(int, char*[]);
 void terminate();
 
 #endif //MASTER_H
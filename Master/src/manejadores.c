@@ -1,74 +1,12 @@
 #include "manejadores.h"
 #include "mstring.h"
 
-void finalizar_manejador_transf(int response, t_socket socket,
-		tEtapaTransformacion* transformacion) {
-
-	if(response == -1){
-		thread_send(hilo_node_drop, (void*)mstring_duplicate(transformacion->nodo));
-		thread_suspend();
-		if(!thread_active()) thread_exit(NULL);
-		log_report("Finalización del hilo %d etapa TRANSFORMACION por caída del nodo: %s",
-				thread_self(),
-				transformacion->nodo);
-	}else{
-		log_print("Finalización hilo %d TRANSFORMACION realizada", thread_self());
-		socket_close(socket);
-		log_print("Conexión a Worker en %s:%s por el socket %i cerrada",
-				transformacion->ip, transformacion->puerto, socket);
-	}
-
-	pthread_mutex_lock(&mutex_hilos);
-	actualizar_hilo(response);
-	pthread_mutex_unlock(&mutex_hilos);
-
-	log_print("Se manda bloque %d\n", transformacion->bloque);
-
-	t_serial *serial_yama = serial_pack("isiis",
-			IDJOB,
-			transformacion->nodo,
-			transformacion->bloque,
-			response,
-			job.arch);
-	enviar_resultado_yama(OP_TRANSFORMACION_LISTA, serial_yama);
-	log_inform("Envío a YAMA socket %d OP_TRANSFORMACION_LISTA",
-			yama_socket);
-	free(transformacion);
-	times.transf_end = mtime_now();
-	thread_sem_signal(sem);
-	thread_exit(0);
-}
-
-void manejador_transformacion(tEtapaTransformacion* transformacion) {
-	log_print("Hilo %d creado ETAPA_TRANSFORMACION", thread_self());
-	int response;
-
-	t_socket socket = connect_to_worker(transformacion->ip, transformacion->puerto);
-
-	if (socket == -1){
-		response = -1;
-		//finalizar_manejador_transf(response, socket, transformacion);
-	}else{
-		t_serial *serial_worker = serial_pack("ssii",
-			script.script_transf,
-			transformacion->archivo_etapa,
-			transformacion->bloque,
-			transformacion->bytes_ocupados);
-			log_inform("Envío a %s socket %d OP_INICIAR_TRANSFORMACION",
-					transformacion->nodo,
-					socket);
-		if(!enviar_operacion_worker(OP_INICIAR_TRANSFORMACION, socket, serial_worker)){
-			response = -1;
-			//finalizar_manejador_transf(response, socket, transformacion);
-		}else{
-			log_inform("Se recibe respuesta de ETAPA_TRANSFORMACION del worker en socket %d",
-					socket);
-			response = protocol_receive_response(socket);
-			if(!thread_active()) thread_exit(NULL);
-		}
-	}
-
-	finalizar_manejador_transf(response, socket, transformacion);
+void cancelar_transformacion(const t_packet* paquete) {
+	char* nodo;
+	int bloque;
+	serial_unpack(paquete->content, "si", &nodo, &bloque);
+	executor_cancel(nodo, bloque);
+	free(nodo);
 }
 
 void finalizar_manejador_rl(int response, t_socket socket,
@@ -84,10 +22,8 @@ void finalizar_manejador_rl(int response, t_socket socket,
 				etapa_rl->nodo);
 	}else{
 		log_print("Finalización hilo %d REDUCCION_LOCAL realizada", thread_self());
-		socket_close(socket);
-		log_print("Conexión a Worker en %s:%s por el socket %i cerrada",
-				etapa_rl->ip, etapa_rl->puerto, socket);
 	}
+	release_worker(socket, etapa_rl->ip, etapa_rl->puerto, response == RESPONSE_OK);
 
 	pthread_mutex_lock(&mutex_hilos);
 	actualizar_hilo(response);
@@ -104,6 +40,7 @@ void finalizar_manejador_rl(int response, t_socket socket,
 void manejador_rl(tEtapaReduccionLocal * etapa_rl) {
 	log_print("Hilo %d creado ETAPA_REDUCCION_LOCAL", thread_self());
 	int response;
+	uint64_t inicio = trace_now();
 
 	t_socket socket = connect_to_worker(etapa_rl->ip, etapa_rl->puerto);
 
@@ -112,7 +49,7 @@ void manejador_rl(tEtapaReduccionLocal * etapa_rl) {
 		//finalizar_manejador_rl(response, socket, etapa_rl);
 	}else{
 		t_serial *serial_worker = serial_create(NULL, 0);
-		serial_add(serial_worker, "s", script.script_reduc);
+		serial_add(serial_worker, "s", script.md5_reduc);
 		serial_add(serial_worker, "i", mlist_length(etapa_rl->archivos_temporales_de_transformacion));
 
 		void routine(char* archivo_temp){
@@ -131,14 +68,56 @@ void manejador_rl(tEtapaReduccionLocal * etapa_rl) {
 		}else{
 			log_inform("Se recibe respuesta de ETAPA_REDUCCION_LOCAL del worker en socket %d",
 					socket);
-			response = protocol_receive_response(socket);
+			response = receive_worker_response(socket);
 			if(!thread_active()) thread_exit(NULL);
 		}
 	}
 
+	trace_span("reduccion_local", inicio, trace_now(), "%s: %d archivos (respuesta %d)", etapa_rl->nodo,
+			mlist_length(etapa_rl->archivos_temporales_de_transformacion), response);
 	finalizar_manejador_rl(response, socket, etapa_rl);
 }
 
+void manejador_apareo(tEtapaReduccionLocal* apareo) {
+	log_print("Hilo %d creado APAREO_PARCIAL", thread_self());
+	int response = -1;
+	uint64_t inicio = trace_now();
+
+	t_socket socket = connect_to_worker(apareo->ip, apareo->puerto);
+	if (socket != -1){
+		t_serial *serial_worker = serial_pack("i",
+				mlist_length(apareo->archivos_temporales_de_transformacion));
+		void routine(char* archivo_temp){
+			serial_add(serial_worker, "s", archivo_temp);
+		}
+		mlist_traverse(apareo->archivos_temporales_de_transformacion, routine);
+		serial_add(serial_worker, "s", apareo->archivo_etapa);
+
+		log_inform("Envío a %s socket %d OP_APAREO_PARCIAL",
+				apareo->nodo,
+				socket);
+		if(enviar_operacion_worker(OP_APAREO_PARCIAL, socket, serial_worker)){
+			response = receive_worker_response(socket);
+			if(!thread_active()) thread_exit(NULL);
+		}
+		release_worker(socket, apareo->ip, apareo->puerto, response == RESPONSE_OK);
+	}
+
+	trace_span("apareo", inicio, trace_now(), "%s: %d archivos (respuesta %d)", apareo->nodo,
+			mlist_length(apareo->archivos_temporales_de_transformacion), response);
+	// Si falla, YAMA deja las salidas sin aparear para la reducción local
+	log_print("Finalización hilo %d APAREO_PARCIAL (%d)", thread_self(), response);
+	pthread_mutex_lock(&mutex_hilos);
+	actualizar_hilo(response);
+	pthread_mutex_unlock(&mutex_hilos);
+
+	enviar_resultado_yama(OP_APAREO_LISTO, serial_pack("isi", IDJOB, apareo->nodo, response));
+	log_inform("Envío a YAMA socket %d OP_APAREO_LISTO",
+			yama_socket);
+	free(apareo);
+	thread_exit(0);
+}
+
 void finalizar_manejador_rg(int response, t_socket socket, mlist_t* list,
 		tEtapaReduccionGlobal* worker) {
 	t_serial *serial_yama = serial_pack("isi", IDJOB, worker->nodo, response);
@@ -149,12 +128,12 @@ void finalizar_manejador_rg(int response, t_socket socket, mlist_t* list,
 				worker->nodo);
 	}else{
 		log_print("Finalización hilo %d REDUCCION_GLOBAL realizada", thread_self());
-		socket_close(socket);
-		log_print("Conexión a Worker en %s:%s por el socket %i cerrada",
-				worker->ip, worker->puerto, socket);
 	}
+	release_worker(socket, worker->ip, worker->puerto, response == RESPONSE_OK);
 
+	pthread_mutex_lock(&mutex_hilos);
 	actualizar_hilo(response);
+	pthread_mutex_unlock(&mutex_hilos);
 
 	enviar_resultado_yama(OP_REDUCCION_GLOBAL_LISTA, serial_yama);
 	log_inform("Envío a YAMA socket %d OP_REDUCCION_GLOBAL_LISTA",
@@ -171,6 +150,7 @@ void finalizar_manejador_rg(int response, t_socket socket, mlist_t* list,
 void manejador_rg(mlist_t* list) {
 	log_print("Hilo %d creado ETAPA_REDUCCION_GLOBAL", thread_self());
 	int response;
+	uint64_t inicio = trace_now();
 
 	bool getManager(tEtapaReduccionGlobal* etapa){
 		return (string_equals_ignore_case(etapa->encargado, SI));
@@ -184,7 +164,7 @@ void manejador_rg(mlist_t* list) {
 		//finalizar_manejador_rg(response, socket, list, worker_manager);
 	}else{
 		t_serial *serial_worker = serial_create(NULL, 0);
-		serial_add(serial_worker, "s", script.script_reduc);
+		serial_add(serial_worker, "s", script.md5_reduc);
 
 		serial_add(serial_worker, "i", mlist_length(list));
 
@@ -210,10 +190,12 @@ void manejador_rg(mlist_t* list) {
 		}else{
 			log_inform("Se recibe respuesta de ETAPA_REDUCCION_GLOBAL del worker en socket %d",
 					socket);
-			response = protocol_receive_response(socket);
+			response = receive_worker_response(socket);
 		}
 	}
 
+	trace_span("reduccion_global", inicio, trace_now(), "%s: %d nodos (respuesta %d)", worker_manager->nodo,
+			mlist_length(list), response);
 	finalizar_manejador_rg(response, socket, list, worker_manager);
 }
 
@@ -228,18 +210,13 @@ void finalizar_manejador_af(int response, t_socket socket, tAlmacenadoFinal* af)
 		break;
 	case RESPONSE_OK:
 		log_print("Finalización hilo %d ALMACENAMIENTO_FINAL realizada", thread_self());
-		socket_close(socket);
-		log_print("Conexión a Worker en %s:%s por el socket %i cerrada",
-				af->ip, af->puerto, socket);
 		break;
 	default:
 		log_report("Finalización hilo %d ALMACENAMIENTO_FINAL no realizada", thread_self());
-		socket_close(socket);
-		log_print("Conexión a Worker en %s:%s por el socket %i cerrada",
-				af->ip, af->puerto, socket);
 		response = -1;
 		break;
 	}
+	release_worker(socket, af->ip, af->puerto, response == RESPONSE_OK);
 
 	actualizar_hilo(response);
 
@@ -257,6 +234,7 @@ void finalizar_manejador_af(int response, t_socket socket, tAlmacenadoFinal* af)
 void manejador_af(tAlmacenadoFinal* af) {
 	log_print("Hilo %d creado ETAPA_ALMACENAMIENTO_FINAL", thread_self());
 	int response;
+	uint64_t inicio = trace_now();
 
 	t_socket socket = connect_to_worker(af->ip, af->puerto);
 	if (socket == -1){
@@ -278,6 +256,7 @@ void manejador_af(tAlmacenadoFinal* af) {
 		}
 	}
 
+	trace_span("almacenamiento", inicio, trace_now(), "%s: %s (respuesta %d)", af->nodo, job.arch_result, response);
 	finalizar_manejador_af(response, socket, af);
 }
 
@@ -287,27 +266,16 @@ void etapa_transformacion(const t_packet* paquete) {
 	bool getTransformacion(t_hilos* hilo){
 		return (hilo->etapa == TRANSFORMACION);
 	}
+	pthread_mutex_lock(&mutex_hilos);
 	if(mlist_count(hilos, getTransformacion) == 0){
 		times.transf_init = mtime_now();
 		times.transf_end = mtime_now();
 	}
+	pthread_mutex_unlock(&mutex_hilos);
 
-	for (int i = 0; i < mlist_length(listTranformacion); i++) {
-		tEtapaTransformacion* etapa_transformacion = mlist_get(
-				listTranformacion, i);
-		t_hilos* hilo_transformacion = set_hilo(TRANSFORMACION, etapa_transformacion->nodo);
-		thread_sem_wait(sem);
-		if ((hilo_transformacion->hilo = thread_create(manejador_transformacion,
-				etapa_transformacion)) < 0) {
-			log_report("Error al crear hilo en INICIAR_TRANSFORMACION");
-			perror("Error al crear el hilo_transformacion");
-		}
-
-		pthread_mutex_lock(&mutex_hilos);
-		mlist_append(hilos, hilo_transformacion);
-		verificarParalelismo(TRANSFORMACION);
-		pthread_mutex_unlock(&mutex_hilos);
-	}
+	// El despachador arma un lote por nodo y lo atiende sin crear hilos
+	executor_submit(listTranformacion);
+	mlist_destroy(listTranformacion, NULL);
 }
 
 void etapa_reduccion_local(const t_packet* paquete) {
@@ -334,6 +302,21 @@ void etapa_reduccion_local(const t_packet* paquete) {
 	pthread_mutex_unlock(&mutex_hilos);
 }
 
+void etapa_apareo(const t_packet* paquete) {
+	tEtapaReduccionLocal* apareo = etapa_rl_unpack(paquete->content);
+	t_hilos* hilo_apareo = set_hilo(APAREO, apareo->nodo);
+
+	if ((hilo_apareo->hilo = thread_create(manejador_apareo, apareo))
+			< 0) {
+		log_report("Error al crear hilo en INICIAR_APAREO");
+		perror("Error al crear el hilo_apareo");
+	}
+
+	pthread_mutex_lock(&mutex_hilos);
+	mlist_append(hilos, hilo_apareo);
+	pthread_mutex_unlock(&mutex_hilos);
+}
+
 void etapa_reduccion_global(const t_packet* paquete) {
 	mlist_t* listReduccionGlobal = list_reduccionGlobal_unpack(
 			paquete->content);
@@ -359,7 +342,10 @@ void etapa_reduccion_global(const t_packet* paquete) {
 		perror("Error al crear el hilo_reduccion_global");
 	}
 
+	// Con reducción en árbol puede haber varias reducciones globales a la vez
+	pthread_mutex_lock(&mutex_hilos);
 	mlist_append(hilos, hilo_rg);
+	pthread_mutex_unlock(&mutex_hilos);
 }
 
 void etapa_almacenamiento(const t_packet* paquete) {
@@ -390,6 +376,10 @@ void manejador_yama(t_packet paquete) {
 		log_inform("OP_INICIAR_REDUCCION_LOCAL");
 		etapa_reduccion_local(&paquete);
 		break;
+	case OP_INICIAR_APAREO:
+		log_inform("OP_INICIAR_APAREO");
+		etapa_apareo(&paquete);
+		break;
 	case OP_INICIAR_REDUCCION_GLOBAL:
 		log_inform("OP_INICIAR_REDUCCION_GLOBAL");
 		etapa_reduccion_global(&paquete);
@@ -398,6 +388,10 @@ void manejador_yama(t_packet paquete) {
 		log_inform("OP_INICIAR_ALMACENAMIENTO");
 		etapa_almacenamiento(&paquete);
 		break;
+	case OP_CANCELAR_TRANSFORMACION:
+		log_inform("OP_CANCELAR_TRANSFORMACION");
+		cancelar_transformacion(&paquete);
+		break;
 	case OP_ERROR_JOB:
 		thread_term();
 		serial_unpack(paquete.content, "i", &exit_code);
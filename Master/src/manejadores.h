@@ -3,10 +3,12 @@
 
 #include "funcionesMaster.h"
 #include "connection.h"
+#include "executor.h"
 #include <protocol.h>
 #include <file.h>
 #include <log.h>
 #include <thread.h>
+#include <trace.h>
 #include <protocol.h>
 #include <pthread.h>
 #include <serial.h>
@@ -25,6 +27,8 @@
 
 void manejador_yama(t_packet);
 
+void cancelar_transformacion(const t_packet*);
+
 void manejador_worker();
 
 
@@ -0,0 +1,80 @@
+#include "buffer.h"
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <data.h>
+
+#define CLASES (sizeof clases / sizeof clases[0])
+#define FUERA_DE_CLASE -1
+
+typedef struct {
+	size_t size;			// Capacidad de cada buffer de la clase
+	int maximo;				// Buffers libres que se guardan como máximo
+	int libres;
+	void **pila;
+	pthread_mutex_t mutex;
+} t_clase;
+
+// Encabezado antes de los datos: indica a qué clase vuelve el buffer
+typedef struct {
+	alignas(max_align_t) int clase;
+} t_encabezado;
+
+static t_clase clases[] = {
+	{512, 64, 0, NULL, PTHREAD_MUTEX_INITIALIZER},				// Respuestas y avisos de tareas
+	{4096, 32, 0, NULL, PTHREAD_MUTEX_INITIALIZER},			// Etapas y listas chicas
+	{65536, 16, 0, NULL, PTHREAD_MUTEX_INITIALIZER},			// Listas de bloques y tablas de archivos
+	{BLOCK_SIZE, 8, 0, NULL, PTHREAD_MUTEX_INITIALIZER}		// Bloques de datos
+};
+
+static int clase_de(size_t size);
+
+// ========== Funciones públicas ==========
+
+void *buffer_get(size_t size) {
+	int clase = clase_de(size);
+	t_encabezado *encabezado = NULL;
+
+	if(clase != FUERA_DE_CLASE) {
+		t_clase *c = &clases[clase];
+		pthread_mutex_lock(&c->mutex);
+		if(c->libres > 0) encabezado = c->pila[--c->libres];
+		pthread_mutex_unlock(&c->mutex);
+		size = c->size;
+	}
+
+	if(encabezado == NULL) {
+		encabezado = malloc(sizeof(t_encabezado) + size);
+		if(encabezado == NULL) return NULL;
+		encabezado->clase = clase;
+	}
+	return encabezado + 1;
+}
+
+void buffer_release(void *buffer) {
+	if(buffer == NULL) return;
+	t_encabezado *encabezado = (t_encabezado*) buffer - 1;
+	if(encabezado->clase == FUERA_DE_CLASE) {
+		free(encabezado);
+		return;
+	}
+
+	t_clase *c = &clases[encabezado->clase];
+	pthread_mutex_lock(&c->mutex);
+	if(c->pila == NULL) c->pila = malloc(c->maximo * sizeof(void*));
+	bool guardado = c->pila != NULL && c->libres < c->maximo;
+	if(guardado) c->pila[c->libres++] = encabezado;
+	pthread_mutex_unlock(&c->mutex);
+	if(!guardado) free(encabezado);
+}
+
+// ========== Funciones privadas ==========
+
+static int clase_de(size_t size) {
+	for(int i = 0; i < CLASES; i++) {
+		if(size <= clases[i].size) return i;
+	}
+	return FUERA_DE_CLASE;
+}
@@ -0,0 +1,27 @@
+#ifndef BUFFER_H_
+#define BUFFER_H_
+
+#include <stddef.h>
+
+/*
+ * Pool de buffers por clases de tamaño, para los datos de los paquetes recibidos.
+ * Los buffers liberados se guardan para el próximo pedido de la misma clase,
+ * en lugar de volver al sistema. La clase más grande es la de un bloque de
+ * datos (BLOCK_SIZE): malloc la atendería con mmap/munmap en cada bloque.
+ */
+
+/**
+ * Obtiene un buffer de al menos el tamaño pedido.
+ * Si el tamaño supera la clase más grande, se reserva con malloc.
+ * @param size Tamaño en bytes.
+ * @return Buffer, que debe liberarse con buffer_release().
+ */
+void *buffer_get(size_t size);
+
+/**
+ * Devuelve un buffer al pool (o lo libera si su clase ya tiene suficientes).
+ * @param buffer Buffer obtenido con buffer_get() (puede ser NULL).
+ */
+void buffer_release(void *buffer);
+
+#endif /* BUFFER_H_ */
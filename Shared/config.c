@@ -37,7 +37,8 @@ void config_init() {
 }
 
 const char *config_get(const char *property) {
-	return config_has_property(config, (char*)property) ? config_get_string_value(config, (char*)property) : NULL;
+	if(config == NULL || !config_has_property(config, (char*)property)) return NULL;
+	return config_get_string_value(config, (char*)property);
 }
 
 void config_term() {
@@ -48,6 +49,7 @@ void config_term() {
 void config_reload(){
 	config_term();
 	config_init();
+	log_level(config_get("LOG_NIVEL"));
 }
 
 // ========== Funciones privadas ==========
@@ -15,6 +15,7 @@
 #include <string.h>
 #include <system.h>
 #include <log.h>
+#include <metrics.h>
 #include <number.h>
 #include <file.h>
 #include "data.h"
@@ -42,8 +43,12 @@ void data_open(const char *path, size_t size) {
 
 void data_set(int blockno, void *block) {
 	void *pdata = data.map + blockno * BLOCK_SIZE;
+	uint64_t inicio = metrics_now();
 	memcpy(pdata, block, BLOCK_SIZE);
+	uint64_t copiado = metrics_now();
 	msync(pdata, BLOCK_SIZE, MS_SYNC);
+	metrics_since(metrics_histogram("data_msync_us"), copiado);
+	metrics_since(metrics_histogram("data_escritura_us"), inicio);
 }
 
 void *data_get(int blockno) {
@@ -0,0 +1,90 @@
+#include "heap.h"
+#include <stdlib.h>
+
+struct heap {
+	void **elements;
+	int length;
+	int capacity;
+	bool (*before)(void*, void*);
+};
+
+static void swap(t_heap *heap, int i, int j);
+static void sift_up(t_heap *heap, int index);
+static void sift_down(t_heap *heap, int index);
+
+// ========== Funciones públicas ==========
+
+t_heap *heap_create(void *comparator) {
+	t_heap *heap = malloc(sizeof(t_heap));
+	heap->elements = NULL;
+	heap->length = 0;
+	heap->capacity = 0;
+	heap->before = comparator;
+	return heap;
+}
+
+void heap_push(t_heap *heap, void *element) {
+	if(heap->length == heap->capacity) {
+		heap->capacity = heap->capacity == 0 ? 16 : heap->capacity * 2;
+		heap->elements = realloc(heap->elements, heap->capacity * sizeof(void*));
+	}
+	heap->elements[heap->length++] = element;
+	sift_up(heap, heap->length - 1);
+}
+
+void *heap_pop(t_heap *heap) {
+	if(heap->length == 0) return NULL;
+	void *first = heap->elements[0];
+	heap->elements[0] = heap->elements[--heap->length];
+	sift_down(heap, 0);
+	return first;
+}
+
+void *heap_peek(t_heap *heap) {
+	return heap->length == 0 ? NULL : heap->elements[0];
+}
+
+int heap_length(t_heap *heap) {
+	return heap->length;
+}
+
+bool heap_empty(t_heap *heap) {
+	return heap->length == 0;
+}
+
+void heap_destroy(t_heap *heap, void *destroyer) {
+	void (*destroy)(void*) = destroyer;
+	if(destroy != NULL) {
+		for(int i = 0; i < heap->length; i++) destroy(heap->elements[i]);
+	}
+	free(heap->elements);
+	free(heap);
+}
+
+// ========== Funciones privadas ==========
+
+static void swap(t_heap *heap, int i, int j) {
+	void *aux = heap->elements[i];
+	heap->elements[i] = heap->elements[j];
+	heap->elements[j] = aux;
+}
+
+static void sift_up(t_heap *heap, int index) {
+	while(index > 0) {
+		int parent = (index - 1) / 2;
+		if(!heap->before(heap->elements[index], heap->elements[parent])) return;
+		swap(heap, index, parent);
+		index = parent;
+	}
+}
+
+static void sift_down(t_heap *heap, int index) {
+	while(true) {
+		int first = index, left = 2 * index + 1, right = left + 1;
+		if(left < heap->length && heap->before(heap->elements[left], heap->elements[first])) first = left;
+		if(right < heap->length && heap->before(heap->elements[right], heap->elements[first])) first = right;
+		if(first == index) return;
+		swap(heap, index, first);
+		index = first;
+	}
+}
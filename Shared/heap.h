@@ -0,0 +1,57 @@
+#ifndef HEAP_H_
+#define HEAP_H_
+
+#include <stdbool.h>
+
+typedef struct heap t_heap;
+
+/**
+ * Crea una cola de prioridad (montículo binario).
+ * @param comparator Función bool (*)(void *a, void *b) que indica si a va antes que b.
+ * @return Montículo vacío.
+ */
+t_heap *heap_create(void *comparator);
+
+/**
+ * Agrega un elemento al montículo en O(log n).
+ * @param heap Montículo.
+ * @param element Elemento.
+ */
+void heap_push(t_heap *heap, void *element);
+
+/**
+ * Quita y devuelve el primer elemento del montículo en O(log n).
+ * @param heap Montículo.
+ * @return Primer elemento (NULL si está vacío).
+ */
+void *heap_pop(t_heap *heap);
+
+/**
+ * Devuelve el primer elemento del montículo sin quitarlo.
+ * @param heap Montículo.
+ * @return Primer elemento (NULL si está vacío).
+ */
+void *heap_peek(t_heap *heap);
+
+/**
+ * Devuelve la cantidad de elementos del montículo.
+ * @param heap Montículo.
+ * @return Cantidad de elementos.
+ */
+int heap_length(t_heap *heap);
+
+/**
+ * Indica si el montículo está vacío.
+ * @param heap Montículo.
+ * @return Valor lógico indicando si está vacío.
+ */
+bool heap_empty(t_heap *heap);
+
+/**
+ * Libera el montículo y, opcionalmente, sus elementos.
+ * @param heap Montículo.
+ * @param destroyer Función para liberar cada elemento (puede ser NULL).
+ */
+void heap_destroy(t_heap *heap, void *destroyer);
+
+#endif /* HEAP_H_ */
@@ -0,0 +1,132 @@
+#ifndef LAYOUT_H_
+#define LAYOUT_H_
+
+/*
+ * Empaquetadores especializados para mensajes de formato fijo.
+ * Generan el mismo formato que serial_pack, pero sin interpretar un string
+ * de formato en cada mensaje: el tamaño se calcula antes de escribir y los
+ * datos van directo a un buffer del llamador (o a un único malloc exacto).
+ *
+ * Un formato se describe con una lista de campos:
+ *
+ *   #define LAYOUT_EJEMPLO(F) F(INT, id) F(STR, nodo)
+ *   SERIAL_LAYOUT(ejemplo, LAYOUT_EJEMPLO)
+ *
+ * que genera el tipo t_layout_ejemplo y las funciones:
+ *   layout_ejemplo_size(m)			bytes que ocupa empaquetado
+ *   layout_ejemplo_write(m, buf)	escribe en buf y devuelve los bytes escritos
+ *   layout_ejemplo_pack(m)			contenedor serial con el tamaño justo
+ *   layout_ejemplo_read(m, buf, n)	lee de buf, devuelve false si los datos están truncados
+ * ---
+ * INT : int de 32 bits ('i' en serial_pack)
+ * LONG : entero sin signo de 64 bits ('L' en serial_pack)
+ * STR : string terminado en '\0' ('s' en serial_pack)
+ * ---
+ * Al leer, los strings apuntan dentro del buffer: se duplican si deben
+ * sobrevivir al contenedor.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "serial.h"
+
+#define LAYOUT_TYPE_INT int
+#define LAYOUT_TYPE_LONG unsigned long long
+#define LAYOUT_TYPE_STR const char *
+
+#define LAYOUT_SIZE_INT(v) 4
+#define LAYOUT_SIZE_LONG(v) 8
+#define LAYOUT_SIZE_STR(v) (strlen((v) == NULL ? SERIAL_NULL_STRING : (v)) + 1)
+
+#define LAYOUT_WRITE_INT(buf, v) { \
+	(buf)[0] = (unsigned)(v) >> 24; (buf)[1] = (unsigned)(v) >> 16; \
+	(buf)[2] = (unsigned)(v) >> 8; (buf)[3] = (unsigned)(v); \
+	(buf) += 4; \
+}
+#define LAYOUT_WRITE_LONG(buf, v) { \
+	for(int i = 0; i < 8; i++) (buf)[i] = (unsigned long long)(v) >> (56 - 8 * i); \
+	(buf) += 8; \
+}
+#define LAYOUT_WRITE_STR(buf, v) { \
+	const char *str = (v) == NULL ? SERIAL_NULL_STRING : (v); \
+	size_t len = strlen(str) + 1; \
+	memcpy((buf), str, len); \
+	(buf) += len; \
+}
+
+#define LAYOUT_READ_INT(buf, end, v) { \
+	if((end) - (buf) < 4) return false; \
+	(v) = (int)((unsigned)(buf)[0] << 24 | (unsigned)(buf)[1] << 16 | (unsigned)(buf)[2] << 8 | (buf)[3]); \
+	(buf) += 4; \
+}
+#define LAYOUT_READ_LONG(buf, end, v) { \
+	if((end) - (buf) < 8) return false; \
+	(v) = 0; \
+	for(int i = 0; i < 8; i++) (v) = (v) << 8 | (buf)[i]; \
+	(buf) += 8; \
+}
+#define LAYOUT_READ_STR(buf, end, v) { \
+	const unsigned char *nul = memchr((buf), '\0', (end) - (buf)); \
+	if(nul == NULL) return false; \
+	(v) = strcmp((const char*)(buf), SERIAL_NULL_STRING) == 0 ? NULL : (const char*)(buf); \
+	(buf) = nul + 1; \
+}
+
+#define LAYOUT_MEMBER(kind, field) LAYOUT_TYPE_##kind field;
+#define LAYOUT_SIZE(kind, field) size += LAYOUT_SIZE_##kind(m->field);
+#define LAYOUT_WRITE(kind, field) LAYOUT_WRITE_##kind(buf, m->field)
+#define LAYOUT_READ(kind, field) LAYOUT_READ_##kind(buf, end, m->field)
+
+#define SERIAL_LAYOUT(name, FIELDS) \
+	typedef struct { FIELDS(LAYOUT_MEMBER) } t_layout_##name; \
+	\
+	static inline size_t layout_##name##_size(const t_layout_##name *m) { \
+		size_t size = 0; \
+		FIELDS(LAYOUT_SIZE) \
+		return size; \
+	} \
+	\
+	static inline size_t layout_##name##_write(const t_layout_##name *m, void *buffer) { \
+		unsigned char *buf = buffer; \
+		FIELDS(LAYOUT_WRITE) \
+		return buf - (unsigned char*)buffer; \
+	} \
+	\
+	static inline t_serial *layout_##name##_pack(const t_layout_##name *m) { \
+		t_serial *serial = serial_create(NULL, layout_##name##_size(m)); \
+		layout_##name##_write(m, serial->data); \
+		return serial; \
+	} \
+	\
+	static inline bool layout_##name##_read(t_layout_##name *m, const void *buffer, size_t size) { \
+		const unsigned char *buf = buffer; \
+		const unsigned char *end = buf + size; \
+		FIELDS(LAYOUT_READ) \
+		return true; \
+	}
+
+// ========== Mensajes ==========
+
+// Encabezado de todo paquete: remitente, operación, job de la traza y tamaño del contenido (64 bits)
+#define LAYOUT_HEADER(F) F(INT, sender) F(INT, operation) F(INT, trace) F(LONG, size)
+SERIAL_LAYOUT(header, LAYOUT_HEADER)
+#define LAYOUT_HEADER_SIZE 20
+
+// Prefijo de un contenido en flujo: longitud de los metadatos que preceden a los bytes crudos
+#define LAYOUT_STREAM(F) F(LONG, meta)
+SERIAL_LAYOUT(stream, LAYOUT_STREAM)
+#define LAYOUT_STREAM_SIZE 8
+
+// OP_REQUEST_BLOCK (filesystem -> datanode)
+#define LAYOUT_REQUEST_BLOCK(F) F(INT, blockno) F(INT, receiving)
+SERIAL_LAYOUT(request_block, LAYOUT_REQUEST_BLOCK)
+
+// OP_TRANSFORMACION_LISTA (master -> yama)
+#define LAYOUT_TRANSFORMACION_LISTA(F) \
+	F(INT, job) F(STR, nodo) F(INT, bloque) F(INT, response) \
+	F(STR, archivo) F(INT, cola) F(INT, bytes) F(INT, duracion)
+SERIAL_LAYOUT(transformacion_lista, LAYOUT_TRANSFORMACION_LISTA)
+
+#endif /* LAYOUT_H_ */
@@ -1,42 +1,107 @@
-#include <commons/log.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <log.h>
 #include <mstring.h>
+#include <mtime.h>
 #include <process.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
 #include <system.h>
+#include <time.h>
+#include <unistd.h>
 
 #define LOG_ENABLED true
 #define LOG_MAX 256
+#define RING_SIZE 512		// Mensajes pendientes por hilo antes de descartar
+#define LOTE 65536			// Bytes que junta el escritor antes de cada write
+#define ESPERA 20			// Milisegundos que duerme el escritor si no hay mensajes
 
-static t_log *silent = NULL;
-static t_log *printer = NULL;
+typedef struct {
+	mtime_t time;
+	pid_t tid;
+	bool error;
+	bool print;
+	char message[LOG_MAX];
+} t_entry;
+
+// Cola circular de un solo productor (el hilo dueño) y un solo consumidor (el escritor)
+typedef struct ring {
+	t_entry entries[RING_SIZE];
+	atomic_uint head;		// Próxima posición a escribir: solo la avanza el dueño
+	atomic_uint tail;		// Próxima posición a leer: solo la avanza el escritor
+	atomic_uint dropped;	// Mensajes descartados por tener la cola llena
+	atomic_bool used;		// Si algún hilo vivo es dueño de la cola
+	struct ring *next;
+} t_ring;
+
+typedef struct {
+	char data[LOTE];
+	size_t size;
+	int fd;
+} t_batch;
+
+static _Atomic(t_ring*) rings = NULL;
+static __thread t_ring *own = NULL;
+static __thread pid_t own_tid = 0;
+static pthread_key_t release_key;
+static pthread_t writer;
+static atomic_bool running = false;
+static atomic_int level = LOG_NIVEL_INFORM;
+static atomic_ulong dropped_total = 0;
+static char *program = NULL;
+static pid_t pid = 0;
+static t_batch file_batch;
+static t_batch console_batch;
 
 static void template(bool error, bool print, const char *format, va_list args);
+static t_ring *own_ring(void);
+static void release_ring(void *ring);
+static void *write_loop(void *_);
+static size_t drain(void);
+static void append(t_batch *batch, const t_entry *entry);
+static void flush(t_batch *batch);
+static void create_key(void);
+static void stop_at_exit(void);
 
 // ========== Funciones públicas ==========
 
 void log_init() {
-	if(silent != NULL) return;
+	if(atomic_load(&running)) return;
 	char *pname = (char*) process_name(process_current());
 	char *logfile = mstring_create("%s/logs/%s.log", system_userdir(), pname);
-	pname = mstring_create("%s%s", pname, process_node());
-	silent = log_create(logfile, pname, false, LOG_LEVEL_TRACE);
-	printer = log_create(logfile, pname, true, LOG_LEVEL_TRACE);
+	program = mstring_create("%s%s", pname, process_node());
+	pid = getpid();
+	file_batch = (t_batch) {.size = 0, .fd = open(logfile, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)};
+	console_batch = (t_batch) {.size = 0, .fd = STDOUT_FILENO};
 	free(logfile);
-	free(pname);
+
+	static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+	pthread_once(&key_once, create_key);
+
+	atomic_store(&running, true);
+	pthread_create(&writer, NULL, write_loop, NULL);
 }
 
 void log_inform(const char *format, ...) {
 	va_list args;
 	va_start(args, format);
-	template(false, false, format, args);
+	if(atomic_load_explicit(&level, memory_order_relaxed) <= LOG_NIVEL_INFORM)
+		template(false, false, format, args);
 	va_end(args);
 }
 
 void log_print(const char *format, ...) {
 	va_list args;
 	va_start(args, format);
-	template(false, true, format, args);
+	if(atomic_load_explicit(&level, memory_order_relaxed) <= LOG_NIVEL_PRINT)
+		template(false, true, format, args);
 	va_end(args);
 }
 
@@ -47,22 +112,155 @@ void log_report(const char *format, ...) {
 	va_end(args);
 }
 
+void log_level(const char *nivel) {
+	t_log_nivel valor = LOG_NIVEL_INFORM;
+	if(mstring_equali(nivel, "PRINT")) valor = LOG_NIVEL_PRINT;
+	else if(mstring_equali(nivel, "REPORT")) valor = LOG_NIVEL_REPORT;
+	atomic_store(&level, valor);
+}
+
+unsigned long log_dropped() {
+	return atomic_load(&dropped_total);
+}
+
 void log_term() {
-	log_destroy(silent);
-	log_destroy(printer);
-	silent = NULL;
-	printer = NULL;
+	if(!atomic_exchange(&running, false)) return;
+	pthread_join(writer, NULL);
+	if(file_batch.fd != -1) close(file_batch.fd);
+	file_batch.fd = -1;
+	free(program);
+	program = NULL;
 }
 
 // ========== Funciones privadas ==========
 
 static void template(bool error, bool print, const char *format, va_list args) {
-	if(!LOG_ENABLED || process_current() == PROC_UNDEFINED) return;
+	if(!LOG_ENABLED || process_current() == PROC_UNDEFINED || !atomic_load(&running)) return;
+
+	t_ring *ring = own_ring();
+	unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	if(head - tail == RING_SIZE) {
+		// El hilo no espera al escritor: si la cola está llena, el mensaje se descarta
+		atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+		return;
+	}
+
+	t_entry *entry = &ring->entries[head % RING_SIZE];
+	entry->time = mtime_now();
+	entry->tid = own_tid;
+	entry->error = error;
+	entry->print = print;
+	vsnprintf(entry->message, LOG_MAX, format, args);
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static t_ring *own_ring() {
+	if(own != NULL) return own;
+	own_tid = syscall(SYS_gettid);
+
+	// Primero se reutiliza la cola de algún hilo que ya terminó, si el escritor ya la vació
+	for(t_ring *ring = atomic_load(&rings); ring != NULL && own == NULL; ring = ring->next) {
+		bool libre = false;
+		if(atomic_load(&ring->head) != atomic_load(&ring->tail)) continue;
+		if(atomic_compare_exchange_strong(&ring->used, &libre, true)) own = ring;
+	}
+
+	if(own == NULL) {
+		own = calloc(1, sizeof(t_ring));
+		atomic_store(&own->used, true);
+		own->next = atomic_load(&rings);
+		while(!atomic_compare_exchange_weak(&rings, &own->next, own));
+	}
+
+	pthread_setspecific(release_key, own);
+	return own;
+}
 
-	char log[LOG_MAX];
-	vsnprintf(log, LOG_MAX, format, args);
+static void release_ring(void *ring) {
+	// Lo pendiente lo sigue escribiendo el escritor; la cola queda para otro hilo
+	atomic_store(&((t_ring*) ring)->used, false);
+}
+
+static void *write_loop(void *_) {
+	sigset_t all;
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, NULL);
+
+	struct timespec espera = {0, ESPERA * 1000000L};
+	while(true) {
+		bool activo = atomic_load(&running);
+		// Una vuelta más después de detenerse, para escribir lo que quedó pendiente
+		if(drain() == 0) {
+			if(!activo) break;
+			nanosleep(&espera, NULL);
+		}
+	}
+	return NULL;
+}
+
+static size_t drain() {
+	size_t written = 0;
+	unsigned long dropped = 0;
+
+	for(t_ring *ring = atomic_load(&rings); ring != NULL; ring = ring->next) {
+		unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+		unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+		for(; tail != head; tail++) {
+			t_entry *entry = &ring->entries[tail % RING_SIZE];
+			append(&file_batch, entry);
+			if(entry->print) append(&console_batch, entry);
+			written++;
+		}
+		atomic_store_explicit(&ring->tail, tail, memory_order_release);
+		dropped += atomic_exchange_explicit(&ring->dropped, 0, memory_order_relaxed);
+	}
+
+	if(dropped > 0) {
+		atomic_fetch_add(&dropped_total, dropped);
+		t_entry aviso = {mtime_now(), syscall(SYS_gettid), true, false, ""};
+		snprintf(aviso.message, LOG_MAX, "Se descartaron %lu mensajes de log por saturación", dropped);
+		append(&file_batch, &aviso);
+		written++;
+	}
+
+	flush(&file_batch);
+	flush(&console_batch);
+	return written;
+}
+
+static void append(t_batch *batch, const t_entry *entry) {
+	if(batch->size + LOG_MAX * 2 > LOTE) flush(batch);
+
+	// Mismo formato que las commons: [NIVEL] hh:mm:ss:mmm Proceso/(pid:tid): mensaje
+	time_t seconds = entry->time / 1000;
+	struct tm lt;
+	localtime_r(&seconds, &lt);
+	int n = snprintf(batch->data + batch->size, LOTE - batch->size, "[%s] %02d:%02d:%02d:%03d %s/(%d:%d): %s\n",
+			entry->error ? "ERROR" : "DEBUG",
+			lt.tm_hour, lt.tm_min, lt.tm_sec, (int)(entry->time % 1000),
+			program, pid, entry->tid, entry->message);
+	if(n > 0) batch->size += (size_t) n < LOTE - batch->size ? (size_t) n : LOTE - batch->size - 1;
+}
+
+static void flush(t_batch *batch) {
+	size_t done = 0;
+	while(batch->fd != -1 && done < batch->size) {
+		ssize_t n = write(batch->fd, batch->data + done, batch->size - done);
+		if(n == -1 && errno == EINTR) continue;
+		if(n <= 0) break;
+		done += n;
+	}
+	batch->size = 0;
+}
+
+static void create_key() {
+	pthread_key_create(&release_key, release_ring);
+	atexit(stop_at_exit);
+}
 
-	t_log *logger = print ? printer : silent;
-	if(error) log_error(logger, log);
-	else log_debug(logger, log);
+static void stop_at_exit() {
+	// Si el proceso termina con exit() sin pasar por log_term, no se pierde lo pendiente
+	if(!atomic_exchange(&running, false)) return;
+	pthread_join(writer, NULL);
 }
@@ -1,8 +1,21 @@
 #ifndef LOG_H_
 #define LOG_H_
 
+/*
+ * Los mensajes no se escriben en el hilo que los genera: cada hilo los deja
+ * en su propia cola circular, sin bloqueos, y un hilo escritor los vuelca en
+ * lotes al archivo y a la pantalla. Si la cola de un hilo se llena, sus
+ * mensajes se descartan y se cuentan.
+ */
+
+typedef enum {
+	LOG_NIVEL_INFORM,	// Todos los mensajes
+	LOG_NIVEL_PRINT,	// Solo los que se imprimen por pantalla
+	LOG_NIVEL_REPORT	// Solo los errores
+} t_log_nivel;
+
 /**
- * Inicializa el log del proceso actual.
+ * Inicializa el log del proceso actual y arranca el hilo escritor.
  */
 void log_init(void);
 
@@ -31,7 +44,19 @@ void log_print(const char *format, ...);
 void log_report(const char *format, ...);
 
 /**
- * Termina el log del proceso actual.
+ * Cambia en tiempo de ejecución qué mensajes se registran.
+ * @param nivel INFORM, PRINT o REPORT (cualquier otro valor equivale a INFORM).
+ */
+void log_level(const char *nivel);
+
+/**
+ * Devuelve cuántos mensajes se descartaron por tener la cola llena.
+ * @return Mensajes descartados desde que arrancó el proceso.
+ */
+unsigned long log_dropped(void);
+
+/**
+ * Termina el log del proceso actual, escribiendo antes lo pendiente.
  */
 void log_term(void);
 
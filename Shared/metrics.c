@@ -0,0 +1,286 @@
+#include "metrics.h"
+#include <config.h>
+#include <errno.h>
+#include <mstring.h>
+#include <process.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <system.h>
+#include <time.h>
+#include <unistd.h>
+
+#define METRICS_MAX 256			// Métricas distintas por proceso
+#define METRICS_NAME 128
+#define SUB_BITS 5				// 32 subdivisiones por potencia de 2
+#define SUB_COUNT (1 << SUB_BITS)
+#define BUCKETS (SUB_COUNT + (64 - SUB_BITS) * SUB_COUNT)
+
+typedef enum {
+	METRIC_COUNTER,
+	METRIC_GAUGE,
+	METRIC_HISTOGRAM
+} t_metric_type;
+
+struct metric {
+	char name[METRICS_NAME];
+	t_metric_type type;
+	atomic_llong value;			// Contadores y medidores
+	atomic_ullong count;		// Histogramas: cantidad de valores, suma y máximo
+	atomic_ullong sum;
+	atomic_ullong max;
+	atomic_ullong *buckets;
+};
+
+static t_metric metrics[METRICS_MAX];
+static atomic_int registered = 0;	// Las métricas publicadas no cambian de nombre ni de tipo
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t dump_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stop_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t dumper;
+static bool running = false;
+static unsigned interval = 0;
+
+static t_metric *find_or_create(t_metric_type type, const char *format, va_list args);
+static int bucket_of(uint64_t value);
+static uint64_t bucket_top(int bucket);
+static uint64_t percentile(t_metric *metric, uint64_t count, double q);
+static void base_name(const char *name, char *base);
+static void write_metric(FILE *file, t_metric *metric);
+static void write_sample(FILE *file, const char *name, const char *suffix, const char *label, uint64_t value);
+static void *dump_loop(void *_);
+
+// ========== Funciones públicas ==========
+
+void metrics_init() {
+	if(running) return;
+	const char *valor = config_get("METRICAS_INTERVALO");
+	interval = valor == NULL ? 0 : mstring_toint(valor);
+	if(interval == 0) return;
+	running = true;
+	pthread_create(&dumper, NULL, dump_loop, NULL);
+}
+
+t_metric *metrics_counter(const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	t_metric *metric = find_or_create(METRIC_COUNTER, format, args);
+	va_end(args);
+	return metric;
+}
+
+t_metric *metrics_gauge(const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	t_metric *metric = find_or_create(METRIC_GAUGE, format, args);
+	va_end(args);
+	return metric;
+}
+
+t_metric *metrics_histogram(const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	t_metric *metric = find_or_create(METRIC_HISTOGRAM, format, args);
+	va_end(args);
+	return metric;
+}
+
+void metrics_add(t_metric *metric, int64_t delta) {
+	if(metric == NULL) return;
+	atomic_fetch_add_explicit(&metric->value, delta, memory_order_relaxed);
+}
+
+void metrics_set(t_metric *metric, int64_t value) {
+	if(metric == NULL) return;
+	atomic_store_explicit(&metric->value, value, memory_order_relaxed);
+}
+
+void metrics_record(t_metric *metric, uint64_t value) {
+	if(metric == NULL || metric->buckets == NULL) return;
+	atomic_fetch_add_explicit(&metric->buckets[bucket_of(value)], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&metric->sum, value, memory_order_relaxed);
+	unsigned long long max = atomic_load_explicit(&metric->max, memory_order_relaxed);
+	while(value > max && !atomic_compare_exchange_weak_explicit(&metric->max, &max, value,
+			memory_order_relaxed, memory_order_relaxed));
+	// La cantidad va última: quien la lee ya encuentra el valor en su cubeta
+	atomic_fetch_add_explicit(&metric->count, 1, memory_order_release);
+}
+
+uint64_t metrics_now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void metrics_since(t_metric *metric, uint64_t start) {
+	metrics_record(metric, metrics_now() - start);
+}
+
+void metrics_dump() {
+	const char *pname = process_name(process_current());
+	const char *node = process_node() == NULL ? "" : process_node();
+	char *path = mstring_create("%s/logs/%s%s.metrics", system_userdir(), pname, node);
+	char *temp = mstring_create("%s.tmp", path);
+
+	// Se escribe aparte y se renombra, para que nunca se lea un volcado a medias
+	pthread_mutex_lock(&dump_mutex);
+	FILE *file = fopen(temp, "w");
+	if(file != NULL) {
+		fprintf(file, "# %s%s (pid %d)\n", pname, node, getpid());
+		// Las series de una misma métrica (distintas etiquetas) van juntas, bajo un solo TYPE
+		static const char *types[] = {"counter", "gauge", "summary"};
+		int total = atomic_load_explicit(&registered, memory_order_acquire);
+		bool written[METRICS_MAX] = {false};
+		for(int i = 0; i < total; i++) {
+			if(written[i]) continue;
+			char base[METRICS_NAME], other[METRICS_NAME];
+			base_name(metrics[i].name, base);
+			fprintf(file, "# TYPE %s %s\n", base, types[metrics[i].type]);
+			for(int j = i; j < total; j++) {
+				base_name(metrics[j].name, other);
+				if(written[j] || strcmp(base, other) != 0) continue;
+				write_metric(file, &metrics[j]);
+				written[j] = true;
+			}
+		}
+		if(fclose(file) == 0) rename(temp, path);
+		else unlink(temp);
+	}
+	pthread_mutex_unlock(&dump_mutex);
+
+	free(temp);
+	free(path);
+}
+
+void metrics_term() {
+	if(running) {
+		pthread_mutex_lock(&mutex);
+		running = false;
+		pthread_cond_signal(&stop_cond);
+		pthread_mutex_unlock(&mutex);
+		pthread_join(dumper, NULL);
+	}
+	if(atomic_load(&registered) > 0) metrics_dump();
+}
+
+// ========== Funciones privadas ==========
+
+static t_metric *find_or_create(t_metric_type type, const char *format, va_list args) {
+	char name[METRICS_NAME];
+	vsnprintf(name, sizeof name, format, args);
+
+	// La búsqueda no toma el mutex: solo se agregan métricas al final
+	int total = atomic_load_explicit(&registered, memory_order_acquire);
+	for(int i = 0; i < total; i++) {
+		if(strcmp(metrics[i].name, name) == 0) return metrics[i].type == type ? &metrics[i] : NULL;
+	}
+
+	pthread_mutex_lock(&mutex);
+	t_metric *metric = NULL;
+	total = atomic_load_explicit(&registered, memory_order_relaxed);
+	for(int i = 0; i < total && metric == NULL; i++) {
+		if(strcmp(metrics[i].name, name) == 0) metric = &metrics[i];
+	}
+	if(metric == NULL && total < METRICS_MAX) {
+		metric = &metrics[total];
+		strcpy(metric->name, name);
+		metric->type = type;
+		if(type == METRIC_HISTOGRAM) metric->buckets = calloc(BUCKETS, sizeof(atomic_ullong));
+		atomic_store_explicit(&registered, total + 1, memory_order_release);
+	}
+	pthread_mutex_unlock(&mutex);
+
+	return metric != NULL && metric->type == type ? metric : NULL;
+}
+
+static int bucket_of(uint64_t value) {
+	if(value < SUB_COUNT) return value;
+	int exponent = 63 - __builtin_clzll(value);
+	int sub = (value >> (exponent - SUB_BITS)) - SUB_COUNT;
+	return SUB_COUNT + (exponent - SUB_BITS) * SUB_COUNT + sub;
+}
+
+static uint64_t bucket_top(int bucket) {
+	if(bucket < SUB_COUNT) return bucket;
+	int shift = (bucket - SUB_COUNT) / SUB_COUNT;
+	uint64_t low = (uint64_t)(SUB_COUNT + (bucket - SUB_COUNT) % SUB_COUNT) << shift;
+	return low + ((uint64_t) 1 << shift) - 1;
+}
+
+static uint64_t percentile(t_metric *metric, uint64_t count, double q) {
+	uint64_t rank = q * count;
+	if(rank >= count) rank = count - 1;
+	uint64_t seen = 0;
+	for(int i = 0; i < BUCKETS; i++) {
+		seen += atomic_load_explicit(&metric->buckets[i], memory_order_relaxed);
+		if(seen > rank) {
+			// El valor más alto de la cubeta, sin pasarse del máximo registrado
+			uint64_t top = bucket_top(i);
+			uint64_t max = atomic_load_explicit(&metric->max, memory_order_relaxed);
+			return top < max ? top : max;
+		}
+	}
+	return atomic_load_explicit(&metric->max, memory_order_relaxed);
+}
+
+static void base_name(const char *name, char *base) {
+	strcpy(base, name);
+	char *labels = strchr(base, '{');
+	if(labels != NULL) *labels = '\0';
+}
+
+static void write_metric(FILE *file, t_metric *metric) {
+	if(metric->type != METRIC_HISTOGRAM) {
+		fprintf(file, "%s %lld\n", metric->name, atomic_load_explicit(&metric->value, memory_order_relaxed));
+		return;
+	}
+
+	uint64_t count = atomic_load_explicit(&metric->count, memory_order_acquire);
+	if(count > 0) {
+		char label[32];
+		const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+		for(int i = 0; i < 4; i++) {
+			snprintf(label, sizeof label, "quantile=\"%g\"", quantiles[i]);
+			write_sample(file, metric->name, "", label, percentile(metric, count, quantiles[i]));
+		}
+	}
+	write_sample(file, metric->name, "_max", NULL, atomic_load_explicit(&metric->max, memory_order_relaxed));
+	write_sample(file, metric->name, "_sum", NULL, atomic_load_explicit(&metric->sum, memory_order_relaxed));
+	write_sample(file, metric->name, "_count", NULL, count);
+}
+
+static void write_sample(FILE *file, const char *name, const char *suffix, const char *label, uint64_t value) {
+	// nombre{etiquetas} -> nombre<sufijo>{etiquetas,etiqueta}
+	const char *labels = strchr(name, '{');
+	int length = labels == NULL ? (int) strlen(name) : labels - name;
+	fprintf(file, "%.*s%s", length, name, suffix);
+	if(labels != NULL && label != NULL) fprintf(file, "%.*s,%s}", (int) strlen(labels) - 1, labels, label);
+	else if(labels != NULL) fprintf(file, "%s", labels);
+	else if(label != NULL) fprintf(file, "{%s}", label);
+	fprintf(file, " %llu\n", (unsigned long long) value);
+}
+
+static void *dump_loop(void *_) {
+	sigset_t all;
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, NULL);
+
+	pthread_mutex_lock(&mutex);
+	while(running) {
+		struct timespec until;
+		clock_gettime(CLOCK_REALTIME, &until);
+		until.tv_sec += interval;
+		while(running && pthread_cond_timedwait(&stop_cond, &mutex, &until) != ETIMEDOUT);
+		if(!running) break;
+		pthread_mutex_unlock(&mutex);
+		metrics_dump();
+		pthread_mutex_lock(&mutex);
+	}
+	pthread_mutex_unlock(&mutex);
+	return NULL;
+}
@@ -0,0 +1,93 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <stdint.h>
+
+/*
+ * Registro de métricas del proceso: contadores, medidores e histogramas.
+ * Las métricas se crean la primera vez que se las nombra y se actualizan
+ * sin bloqueos. Un hilo las vuelca periódicamente (METRICAS_INTERVALO, en
+ * segundos) a logs/<Proceso><nodo>.metrics en formato de texto de
+ * Prometheus, reemplazando el archivo de forma atómica para poder leerlo
+ * en cualquier momento.
+ * ---
+ * El nombre puede llevar etiquetas, por ejemplo: fs_bloque_envio_us{nodo="NODO1"}
+ * ---
+ * Los histogramas usan cubetas logarítmicas con 32 subdivisiones por
+ * potencia de 2 (error relativo menor al 3%), como un histograma HDR:
+ * ocupan memoria fija sin importar cuántos valores se registren.
+ */
+
+typedef struct metric t_metric;
+
+/**
+ * Inicializa el registro y arranca el volcado periódico.
+ */
+void metrics_init(void);
+
+/**
+ * Obtiene (o crea) un contador, que solo se incrementa.
+ * @param format Formato del nombre, como en printf.
+ * @return Contador.
+ */
+t_metric *metrics_counter(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * Obtiene (o crea) un medidor, que refleja un valor instantáneo.
+ * @param format Formato del nombre, como en printf.
+ * @return Medidor.
+ */
+t_metric *metrics_gauge(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * Obtiene (o crea) un histograma.
+ * @param format Formato del nombre, como en printf.
+ * @return Histograma.
+ */
+t_metric *metrics_histogram(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * Suma a un contador o a un medidor.
+ * @param metric Métrica (puede ser NULL si el registro está lleno).
+ * @param delta Cantidad a sumar.
+ */
+void metrics_add(t_metric *metric, int64_t delta);
+
+/**
+ * Fija el valor de un medidor.
+ * @param metric Medidor (puede ser NULL si el registro está lleno).
+ * @param value Valor actual.
+ */
+void metrics_set(t_metric *metric, int64_t value);
+
+/**
+ * Registra un valor en un histograma.
+ * @param metric Histograma (puede ser NULL si el registro está lleno).
+ * @param value Valor a registrar.
+ */
+void metrics_record(t_metric *metric, uint64_t value);
+
+/**
+ * Devuelve un instante de un reloj monótono, para medir duraciones.
+ * @return Instante en microsegundos.
+ */
+uint64_t metrics_now(void);
+
+/**
+ * Registra en un histograma los microsegundos transcurridos desde un instante.
+ * @param metric Histograma.
+ * @param start Instante obtenido con metrics_now().
+ */
+void metrics_since(t_metric *metric, uint64_t start);
+
+/**
+ * Vuelca todas las métricas al archivo del proceso.
+ */
+void metrics_dump(void);
+
+/**
+ * Detiene el volcado periódico y hace un último volcado.
+ */
+void metrics_term(void);
+
+#endif /* METRICS_H_ */
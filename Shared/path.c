@@ -18,6 +18,7 @@
 #include <file.h>
 #include <unistd.h>
 #include <data.h>
+#include <pipeline.h>
 #ifndef __USE_XOPEN_EXTENDED
 #define __USE_XOPEN_EXTENDED
 #endif
@@ -371,7 +372,7 @@ void path_merge(mlist_t *sources, const char *target) {
 		char *line;
 	} t_cont;
 	t_cont *map_cont(const char *source) {
-		t_cont *cont = malloc(sizeof(cont));
+		t_cont *cont = malloc(sizeof(t_cont));
 		cont->file = file_open(source);
 		cont->line = NULL;
 		return cont;
@@ -425,14 +426,17 @@ bool path_reduce(const char *input, const char *script, const char *output) {
 	char *inpath = path_create(PTYPE_YATPOS, input);
 	char *outpath = path_create(PTYPE_YATPOS, output);
 
-	char *command = mstring_create("cat %s | %s > %s", inpath, scrpath, outpath);
-	int r = system(command);
+	t_pipeline *pipeline = pipeline_create();
+	pipeline_input(pipeline, inpath, 0, -1);
+	pipeline_add(pipeline, scrpath);
+	pipeline_output(pipeline, outpath);
+	bool r = pipeline_run(pipeline);
+	pipeline_destroy(pipeline);
 
 	free(inpath);
 	free(outpath);
-	free(command);
 	free(scrpath);
-	return r == 0;
+	return r;
 }
 
 // ========== Funciones privadas ==========
@@ -0,0 +1,408 @@
+#define _GNU_SOURCE
+#include "pipeline.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <mstring.h>
+
+#define CHUNK 65536
+
+extern char **environ;
+
+typedef struct {
+	char **argv;
+	int argc;
+	pid_t pid;
+	t_pstats stats;
+} t_stage;
+
+// Copia datos de un descriptor a otro dentro del kernel (splice), contando bytes
+typedef struct {
+	int src;			// Descriptor del que se lee
+	int dst;			// Descriptor en el que se escribe (-1 si ya terminó)
+	bool file;			// Si src es un archivo (se lee desde offset hasta remaining)
+	loff_t offset;
+	size_t remaining;
+	bool writable;		// Si dst aceptaba datos la última vez que se intentó
+	size_t bytes;
+	double closed;		// Instante en que se cerró (fin de la salida de la etapa anterior)
+} t_relay;
+
+struct pipeline {
+	t_stage *stages;
+	int count;
+	char *input;
+	off_t offset;
+	ssize_t length;
+	char *output;
+	pthread_mutex_t lock;
+	pid_t group;		// Grupo de procesos de las etapas (-1 si no hay etapas corriendo)
+	bool cancelled;
+};
+
+static void make_pipe(int fds[2]);
+static void stage_args(t_stage *stage, const char *program, va_list ap);
+static pid_t spawn_stage(t_stage *stage, int in, int out, pid_t group);
+static void relay_step(t_relay *relay);
+static void relay_close(t_relay *relay);
+static void run_relays(t_relay *relays, int count);
+static double cpu_seconds(struct rusage *usage);
+static double now_seconds(void);
+
+// ========== Funciones públicas ==========
+
+t_pipeline *pipeline_create() {
+	t_pipeline *pipeline = malloc(sizeof(t_pipeline));
+	pipeline->stages = NULL;
+	pipeline->count = 0;
+	pipeline->input = NULL;
+	pipeline->offset = 0;
+	pipeline->length = -1;
+	pipeline->output = NULL;
+	pthread_mutex_init(&pipeline->lock, NULL);
+	pipeline->group = -1;
+	pipeline->cancelled = false;
+	return pipeline;
+}
+
+void _pipeline_add(t_pipeline *pipeline, const char *program, ...) {
+	pipeline->stages = realloc(pipeline->stages, (pipeline->count + 1) * sizeof(t_stage));
+	t_stage *stage = &pipeline->stages[pipeline->count++];
+	va_list ap;
+	va_start(ap, program);
+	stage_args(stage, program, ap);
+	va_end(ap);
+}
+
+void pipeline_input(t_pipeline *pipeline, const char *path, off_t offset, ssize_t length) {
+	free(pipeline->input);
+	pipeline->input = mstring_duplicate(path);
+	pipeline->offset = offset;
+	pipeline->length = length;
+}
+
+void pipeline_output(t_pipeline *pipeline, const char *path) {
+	free(pipeline->output);
+	pipeline->output = mstring_duplicate(path);
+}
+
+bool pipeline_run(t_pipeline *pipeline) {
+	int n = pipeline->count;
+	if(n == 0) return false;
+	double start = now_seconds();
+
+	// Las escrituras a una tubería sin lector no deben terminar el proceso:
+	// se bloquea SIGPIPE en este hilo y se descarta al final
+	sigset_t sigpipe, oldmask;
+	sigemptyset(&sigpipe);
+	sigaddset(&sigpipe, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &sigpipe, &oldmask);
+
+	// relays[0] alimenta la primera etapa; relays[i] pasa la salida de la etapa i-1 a la i
+	t_relay relays[n];
+	int ins[n], outs[n];
+	memset(relays, 0, sizeof relays);
+	for(int i = 0; i < n; i++) relays[i].src = relays[i].dst = -1;
+
+	const char *input = pipeline->input != NULL ? pipeline->input : "/dev/null";
+	int input_fd = open(input, O_RDONLY | O_CLOEXEC);
+	if(input_fd != -1 && pipeline->length >= 0) {
+		int fds[2];
+		make_pipe(fds);
+		relays[0].src = input_fd;
+		relays[0].dst = fds[1];
+		relays[0].file = true;
+		relays[0].offset = pipeline->offset;
+		relays[0].remaining = pipeline->length;
+		ins[0] = fds[0];
+	} else {
+		// El archivo completo se le da directamente como entrada estándar
+		struct stat st;
+		if(input_fd != -1 && fstat(input_fd, &st) == 0) pipeline->stages[0].stats.bytes_in = st.st_size;
+		ins[0] = input_fd;
+	}
+
+	for(int i = 1; i < n; i++) {
+		int from[2], to[2];
+		make_pipe(from);
+		make_pipe(to);
+		outs[i - 1] = from[1];
+		ins[i] = to[0];
+		relays[i].src = from[0];
+		relays[i].dst = to[1];
+	}
+
+	const char *output = pipeline->output != NULL ? pipeline->output : "/dev/null";
+	outs[n - 1] = open(output, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0664);
+
+	// Todas las etapas van a un grupo propio para que pipeline_cancel las termine juntas,
+	// incluidos los procesos que lancen los scripts
+	pthread_mutex_lock(&pipeline->lock);
+	for(int i = 0; i < n; i++) {
+		t_stage *stage = &pipeline->stages[i];
+		stage->pid = ins[i] == -1 || outs[i] == -1 || pipeline->cancelled ? -1
+				: spawn_stage(stage, ins[i], outs[i], pipeline->group == -1 ? 0 : pipeline->group);
+		if(stage->pid != -1 && pipeline->group == -1) pipeline->group = stage->pid;
+		if(ins[i] != -1) close(ins[i]);
+		if(i < n - 1 && outs[i] != -1) close(outs[i]);
+	}
+	pthread_mutex_unlock(&pipeline->lock);
+
+	run_relays(relays, n);
+
+	// El líder del grupo se espera último: hasta entonces su pid no se reutiliza
+	// y pipeline_cancel puede mandar la señal al grupo sin riesgo
+	bool ok = true;
+	for(int k = 0; k < n; k++) {
+		int i = (k + 1) % n;
+		t_stage *stage = &pipeline->stages[i];
+		if(stage->pid != -1 && stage->pid == pipeline->group) {
+			pthread_mutex_lock(&pipeline->lock);
+			pipeline->group = -1;
+			pthread_mutex_unlock(&pipeline->lock);
+		}
+		if(i > 0 || relays[0].file) stage->stats.bytes_in = relays[i].bytes;
+		if(i < n - 1) stage->stats.bytes_out = relays[i + 1].bytes;
+		stage->stats.status = -1;
+		if(stage->pid == -1) {
+			ok = false;
+			continue;
+		}
+
+		int status;
+		struct rusage usage;
+		pid_t r;
+		while(r = wait4(stage->pid, &status, 0, &usage), r == -1 && errno == EINTR);
+		if(r != -1 && WIFEXITED(status)) stage->stats.status = WEXITSTATUS(status);
+		if(r != -1) stage->stats.cpu = cpu_seconds(&usage);
+		// La última etapa escribe directo al archivo: termina cuando termina el proceso
+		stage->stats.elapsed = (i < n - 1 ? relays[i + 1].closed : now_seconds()) - start;
+		ok = ok && stage->stats.status == 0;
+	}
+
+	if(outs[n - 1] != -1) {
+		struct stat st;
+		if(fstat(outs[n - 1], &st) == 0) pipeline->stages[n - 1].stats.bytes_out = st.st_size;
+		close(outs[n - 1]);
+	}
+
+	struct timespec zero = {0, 0};
+	while(sigtimedwait(&sigpipe, NULL, &zero) == SIGPIPE);
+	pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+	return ok;
+}
+
+int pipeline_length(t_pipeline *pipeline) {
+	return pipeline->count;
+}
+
+const char *pipeline_program(t_pipeline *pipeline, int stage) {
+	return pipeline->stages[stage].argv[0];
+}
+
+t_pstats pipeline_stats(t_pipeline *pipeline, int stage) {
+	return pipeline->stages[stage].stats;
+}
+
+pid_t _pipeline_spawn(int in, int out, const char *program, ...) {
+	t_stage stage;
+	va_list ap;
+	va_start(ap, program);
+	stage_args(&stage, program, ap);
+	va_end(ap);
+
+	pid_t pid = spawn_stage(&stage, in, out, -1);
+	for(int i = 0; i < stage.argc; i++) free(stage.argv[i]);
+	free(stage.argv);
+	return pid;
+}
+
+bool pipeline_wait(pid_t pid) {
+	int status;
+	pid_t r;
+	while(r = waitpid(pid, &status, 0), r == -1 && errno == EINTR);
+	return r != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+void pipeline_cancel(t_pipeline *pipeline) {
+	pthread_mutex_lock(&pipeline->lock);
+	pipeline->cancelled = true;
+	if(pipeline->group != -1) kill(-pipeline->group, SIGKILL);
+	pthread_mutex_unlock(&pipeline->lock);
+}
+
+bool pipeline_cancelled(t_pipeline *pipeline) {
+	pthread_mutex_lock(&pipeline->lock);
+	bool cancelled = pipeline->cancelled;
+	pthread_mutex_unlock(&pipeline->lock);
+	return cancelled;
+}
+
+void pipeline_destroy(t_pipeline *pipeline) {
+	if(pipeline == NULL) return;
+	for(int i = 0; i < pipeline->count; i++) {
+		t_stage *stage = &pipeline->stages[i];
+		for(int j = 0; j < stage->argc; j++) free(stage->argv[j]);
+		free(stage->argv);
+	}
+	free(pipeline->stages);
+	free(pipeline->input);
+	free(pipeline->output);
+	pthread_mutex_destroy(&pipeline->lock);
+	free(pipeline);
+}
+
+// ========== Funciones privadas ==========
+
+static void make_pipe(int fds[2]) {
+	if(pipe2(fds, O_CLOEXEC) == -1) {
+		fds[0] = fds[1] = -1;
+		return;
+	}
+	// Solo los extremos que usa este proceso son no bloqueantes
+	fcntl(fds[0], F_SETFL, O_NONBLOCK);
+	fcntl(fds[1], F_SETFL, O_NONBLOCK);
+}
+
+static void stage_args(t_stage *stage, const char *program, va_list ap) {
+	memset(stage, 0, sizeof(t_stage));
+	stage->pid = -1;
+	for(const char *arg = program; arg != NULL; arg = va_arg(ap, const char*)) {
+		stage->argv = realloc(stage->argv, (stage->argc + 2) * sizeof(char*));
+		stage->argv[stage->argc++] = mstring_duplicate(arg);
+	}
+	stage->argv[stage->argc] = NULL;
+}
+
+static pid_t spawn_stage(t_stage *stage, int in, int out, pid_t group) {
+	// dup2 quita O_CLOEXEC de 0 y 1; el resto de los descriptores se cierran al hacer exec
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, in, STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, out, STDOUT_FILENO);
+
+	// La etapa no hereda el SIGPIPE bloqueado ni ignorado
+	sigset_t empty, sigpipe;
+	sigemptyset(&empty);
+	sigemptyset(&sigpipe);
+	sigaddset(&sigpipe, SIGPIPE);
+	posix_spawnattr_t attr;
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setsigmask(&attr, &empty);
+	posix_spawnattr_setsigdefault(&attr, &sigpipe);
+	short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+	if(group != -1) {
+		// 0 crea un grupo nuevo con la etapa como líder
+		posix_spawnattr_setpgroup(&attr, group);
+		flags |= POSIX_SPAWN_SETPGROUP;
+	}
+	posix_spawnattr_setflags(&attr, flags);
+
+	// Los extremos no bloqueantes son los del proceso; la etapa los necesita bloqueantes
+	fcntl(in, F_SETFL, fcntl(in, F_GETFL) & ~O_NONBLOCK);
+	fcntl(out, F_SETFL, fcntl(out, F_GETFL) & ~O_NONBLOCK);
+
+	pid_t pid;
+	int r = posix_spawnp(&pid, stage->argv[0], &actions, &attr, stage->argv, environ);
+	if(r == ENOEXEC) {
+		// Scripts sin #! se ejecutan con el intérprete de comandos, como hacía system()
+		char *argv[stage->argc + 2];
+		argv[0] = "/bin/sh";
+		memcpy(argv + 1, stage->argv, (stage->argc + 1) * sizeof(char*));
+		r = posix_spawn(&pid, "/bin/sh", &actions, &attr, argv, environ);
+	}
+
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+	return r == 0 ? pid : -1;
+}
+
+static void run_relays(t_relay *relays, int count) {
+	struct pollfd fds[count];
+	t_relay *owners[count];
+
+	while(true) {
+		int polled = 0;
+		for(int i = 0; i < count; i++) {
+			t_relay *relay = &relays[i];
+			if(relay->dst != -1 && relay->writable && relay->file) relay_step(relay);
+			if(relay->dst == -1) continue;
+
+			// Se espera a que dst acepte datos, y recién entonces a que src tenga
+			if(!relay->writable) fds[polled] = (struct pollfd) {relay->dst, POLLOUT, 0};
+			else fds[polled] = (struct pollfd) {relay->src, POLLIN, 0};
+			owners[polled++] = relay;
+		}
+		if(polled == 0) return;
+
+		if(poll(fds, polled, -1) == -1) {
+			if(errno == EINTR) continue;
+			for(int i = 0; i < polled; i++) relay_close(owners[i]);
+			return;
+		}
+
+		for(int i = 0; i < polled; i++) {
+			if(fds[i].revents == 0) continue;
+			t_relay *relay = owners[i];
+			if(!relay->writable) relay->writable = true;
+			else relay_step(relay);
+		}
+	}
+}
+
+static void relay_step(t_relay *relay) {
+	while(true) {
+		size_t length = CHUNK;
+		if(relay->file && relay->remaining < length) length = relay->remaining;
+		if(length == 0) {
+			relay_close(relay);
+			return;
+		}
+
+		ssize_t r = splice(relay->src, relay->file ? &relay->offset : NULL,
+				relay->dst, NULL, length, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if(r > 0) {
+			relay->bytes += r;
+			if(relay->file) relay->remaining -= r;
+		} else if(r == 0) {
+			relay_close(relay);
+			return;
+		} else if(errno == EAGAIN) {
+			// Puede que src no tenga datos o que dst esté lleno: se vuelve a esperar a dst
+			relay->writable = false;
+			return;
+		} else if(errno != EINTR) {
+			relay_close(relay);
+			return;
+		}
+	}
+}
+
+static void relay_close(t_relay *relay) {
+	close(relay->src);
+	close(relay->dst);
+	relay->src = relay->dst = -1;
+	relay->closed = now_seconds();
+}
+
+static double cpu_seconds(struct rusage *usage) {
+	return usage->ru_utime.tv_sec + usage->ru_stime.tv_sec
+			+ (usage->ru_utime.tv_usec + usage->ru_stime.tv_usec) / 1e6;
+}
+
+static double now_seconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,127 @@
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef struct {
+	int status;			// Código de salida (-1 si no se pudo ejecutar o lo terminó una señal)
+	double cpu;			// Segundos de CPU consumidos (usuario + sistema)
+	size_t bytes_in;	// Bytes recibidos por entrada estándar
+	size_t bytes_out;	// Bytes escritos por salida estándar
+	double elapsed;		// Segundos desde que arrancó la tubería hasta que la etapa terminó de escribir
+} t_pstats;
+
+typedef struct pipeline t_pipeline;
+
+/**
+ * Crea una tubería de procesos vacía.
+ * A diferencia de system(), los procesos se lanzan directamente con
+ * posix_spawn (sin pasar por /bin/sh) y las tuberías las conecta el
+ * propio proceso, que además mide lo que pasa por cada etapa.
+ * @return Tubería (debe ser liberada con pipeline_destroy).
+ */
+t_pipeline *pipeline_create(void);
+
+/**
+ * Agrega una etapa al final de la tubería.
+ * El programa se busca en el PATH si no contiene '/'.
+ * Uso: pipeline_add(pipeline, "sort", "-k1") (los argumentos son opcionales).
+ * @param pipeline Tubería.
+ * @param program Programa a ejecutar, seguido de sus argumentos.
+ */
+#define pipeline_add(pipeline, ...) _pipeline_add(pipeline, __VA_ARGS__, NULL)
+void _pipeline_add(t_pipeline *pipeline, const char *program, ...);
+
+/**
+ * Define la entrada de la primera etapa como un fragmento de un archivo.
+ * Si no se define, la primera etapa lee de /dev/null.
+ * @param pipeline Tubería.
+ * @param path Ruta absoluta al archivo.
+ * @param offset Posición desde la que se lee.
+ * @param length Cantidad de bytes a leer (-1 para leer el archivo completo).
+ */
+void pipeline_input(t_pipeline *pipeline, const char *path, off_t offset, ssize_t length);
+
+/**
+ * Define el archivo donde escribe la última etapa (se trunca si existe).
+ * Si no se define, la salida se descarta.
+ * @param pipeline Tubería.
+ * @param path Ruta absoluta al archivo.
+ */
+void pipeline_output(t_pipeline *pipeline, const char *path);
+
+/**
+ * Ejecuta la tubería y espera a que terminen todas sus etapas.
+ * @param pipeline Tubería.
+ * @return Valor lógico indicando si todas las etapas terminaron con código 0.
+ */
+bool pipeline_run(t_pipeline *pipeline);
+
+/**
+ * Termina las etapas de una tubería que está corriendo en otro hilo.
+ * Las etapas corren en un grupo de procesos propio, así que también terminan
+ * los procesos que hayan lanzado. pipeline_run() devuelve false. Si la
+ * tubería todavía no arrancó, ya no lanza ninguna etapa.
+ * @param pipeline Tubería.
+ */
+void pipeline_cancel(t_pipeline *pipeline);
+
+/**
+ * Indica si se canceló la tubería con pipeline_cancel().
+ * @param pipeline Tubería.
+ * @return Valor lógico indicando si se canceló.
+ */
+bool pipeline_cancelled(t_pipeline *pipeline);
+
+/**
+ * Devuelve la cantidad de etapas de la tubería.
+ * @param pipeline Tubería.
+ * @return Cantidad de etapas.
+ */
+int pipeline_length(t_pipeline *pipeline);
+
+/**
+ * Devuelve el programa que ejecuta una etapa.
+ * @param pipeline Tubería.
+ * @param stage Número de etapa (desde 0).
+ * @return Programa de la etapa.
+ */
+const char *pipeline_program(t_pipeline *pipeline, int stage);
+
+/**
+ * Devuelve las estadísticas de una etapa luego de pipeline_run().
+ * @param pipeline Tubería.
+ * @param stage Número de etapa (desde 0).
+ * @return Estadísticas de la etapa.
+ */
+t_pstats pipeline_stats(t_pipeline *pipeline, int stage);
+
+/**
+ * Lanza un programa suelto sin esperar a que termine.
+ * Sirve para leer o escribir un flujo desde el propio proceso (por ejemplo,
+ * un archivo comprimido) sin pasar por un archivo intermedio.
+ * Uso: pipeline_spawn(in, out, "lz4", "-d", "-c") (los argumentos son opcionales).
+ * @param in Descriptor para la entrada estándar del programa.
+ * @param out Descriptor para la salida estándar del programa.
+ * @param program Programa a ejecutar, seguido de sus argumentos.
+ * @return Identificador del proceso (esperarlo con pipeline_wait), o -1 si no se pudo lanzar.
+ */
+#define pipeline_spawn(in, out, ...) _pipeline_spawn(in, out, __VA_ARGS__, NULL)
+pid_t _pipeline_spawn(int in, int out, const char *program, ...);
+
+/**
+ * Espera a que termine un programa lanzado con pipeline_spawn.
+ * @param pid Identificador del proceso.
+ * @return Valor lógico indicando si terminó con código 0.
+ */
+bool pipeline_wait(pid_t pid);
+
+/**
+ * Libera una tubería.
+ * @param pipeline Tubería.
+ */
+void pipeline_destroy(t_pipeline *pipeline);
+
+#endif /* PIPELINE_H_ */
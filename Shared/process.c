@@ -1,10 +1,12 @@
 #include <config.h>
 #include <log.h>
+#include <metrics.h>
 #include <mstring.h>
 #include <path.h>
 #include <process.h>
 #include <system.h>
 #include <thread.h>
+#include <trace.h>
 #include <stdlib.h>
 
 static t_process current = PROC_UNDEFINED;
@@ -21,6 +23,9 @@ void process_init() {
 	system_init();
 	log_init();
 	config_init();
+	log_level(config_get("LOG_NIVEL"));
+	metrics_init();
+	trace_init();
 	thread_init();
 }
 
@@ -48,6 +53,7 @@ const char *_process_node(const char *name) {
 }
 
 void process_term() {
+	metrics_term();
 	thread_term();
 	log_term();
 	config_term();
@@ -1,61 +1,136 @@
 #include "protocol.h"
+#include "buffer.h"
+#include "data.h"
+#include "layout.h"
 #include "serial.h"
 #include "socket.h"
+#include "trace.h"
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
-static const size_t HEADER_SIZE = sizeof(t_process) + sizeof(t_operation) + sizeof(size_t);
+// Remitente, operación y traza de 32 bits y tamaño de 64, sin importar size_t en cada plataforma
+#define HEADER_SIZE LAYOUT_HEADER_SIZE
+#define STREAM_CHUNK BLOCK_SIZE	// Los flujos se copian de a un bloque, con un buffer del pool
+
+static uint64_t receive_header(t_socket socket, t_packet *packet);
+static bool receive_content(t_socket socket, t_packet *packet, uint64_t size);
 
 t_packet protocol_packet(t_operation operation, t_serial *content) {
 	t_packet packet;
 	packet.sender = process_current();
 	packet.operation = operation;
+	packet.trace = trace_current();
 	packet.content = content;
 	return packet;
 }
 
 bool protocol_send_packet(t_packet packet, t_socket socket) {
-	size_t packet_size = packet.content == NULL ? 0 : packet.content->size;
-	packet.sender = process_current();
-	t_serial *header = serial_pack("iii", packet.sender, packet.operation, packet_size);
-	size_t bytes = socket_send_bytes(socket, header->data, header->size);
-	serial_destroy(header);
-	if(bytes != header->size) return false;
-
-	if(packet_size > 0) {
-		bytes = socket_send_bytes(socket, packet.content->data, packet_size);
-		if(bytes != packet_size) return false;
+	if(packet.content == NULL) return protocol_send_iov(socket, packet.operation, NULL, 0);
+	struct iovec body = {packet.content->data, packet.content->size};
+	return protocol_send_iov(socket, packet.operation, &body, 1);
+}
+
+bool protocol_send_iov(t_socket socket, t_operation operation, const struct iovec *body, int count) {
+	uint64_t size = 0;
+	for(int i = 0; i < count; i++) {
+		size += body[i].iov_len;
+	}
+
+	t_layout_header header = {process_current(), operation, trace_current(), size};
+	char buffer[HEADER_SIZE];
+	layout_header_write(&header, buffer);
+
+	struct iovec iov[count + 1];
+	iov[0] = (struct iovec) {buffer, HEADER_SIZE};
+	if(count > 0) memcpy(iov + 1, body, count * sizeof(struct iovec));
+	return socket_send_iov(socket, iov, count + 1) == HEADER_SIZE + size;
+}
+
+bool protocol_send_stream(t_socket socket, t_operation operation, t_serial *meta, int fd, uint64_t size) {
+	size_t meta_size = meta == NULL ? 0 : meta->size;
+	t_layout_header header = {process_current(), operation, trace_current(), LAYOUT_STREAM_SIZE + meta_size + size};
+	t_layout_stream stream = {meta_size};
+	char buffer[HEADER_SIZE + LAYOUT_STREAM_SIZE];
+	layout_stream_write(&stream, buffer + layout_header_write(&header, buffer));
+
+	struct iovec iov[] = {{buffer, sizeof buffer}, {meta == NULL ? NULL : meta->data, meta_size}};
+	if(socket_send_iov(socket, iov, 2) != sizeof buffer + meta_size) return false;
+
+	char *chunk = buffer_get(STREAM_CHUNK);
+	uint64_t sent = 0;
+	while(sent < size) {
+		size_t len = size - sent < STREAM_CHUNK ? size - sent : STREAM_CHUNK;
+		ssize_t n = read(fd, chunk, len);
+		if(n <= 0 || socket_send_bytes(socket, chunk, n) != n) break;
+		sent += n;
 	}
-	return true;
+	buffer_release(chunk);
+	return sent == size;
 }
 
 t_packet protocol_receive_packet(t_socket socket) {
 	t_packet packet;
-	memset(&packet, 0, sizeof packet);
-	packet.content = serial_create(NULL, 0);
-	t_serial *header = serial_create(NULL, HEADER_SIZE);
-	if(socket_receive_bytes(socket, header->data, header->size)) {
-		serial_unpack(header, "iii", &packet.sender, &packet.operation, &packet.content->size);
-	} else {
-		serial_destroy(header);
+	uint64_t size = receive_header(socket, &packet);
+	if(!receive_content(socket, &packet, size)) packet.operation = OP_UNDEFINED;
+	return packet;
+}
+
+t_packet protocol_receive_stream(t_socket socket, uint64_t *size) {
+	t_packet packet;
+	uint64_t total = receive_header(socket, &packet);
+	*size = 0;
+
+	char buffer[LAYOUT_STREAM_SIZE];
+	t_layout_stream stream;
+	if(total < LAYOUT_STREAM_SIZE || !socket_receive_bytes(socket, buffer, LAYOUT_STREAM_SIZE)
+			|| !layout_stream_read(&stream, buffer, LAYOUT_STREAM_SIZE)
+			|| stream.meta > total - LAYOUT_STREAM_SIZE) {
+		packet.operation = OP_UNDEFINED;
+		packet.content = serial_create(NULL, 0);
+		return packet;
 	}
 
-	if(packet.operation != OP_UNDEFINED && packet.content->size > 0) {
-		packet.content->data = malloc(packet.content->size);
-		socket_receive_bytes(socket, packet.content->data, packet.content->size);
+	if(!receive_content(socket, &packet, stream.meta)) {
+		packet.operation = OP_UNDEFINED;
+		return packet;
 	}
+	*size = total - LAYOUT_STREAM_SIZE - stream.meta;
 	return packet;
 }
 
+bool protocol_receive_file(t_socket socket, int fd, uint64_t size) {
+	char *chunk = buffer_get(STREAM_CHUNK);
+	uint64_t received = 0;
+	bool ok = true;
+	while(received < size) {
+		size_t len = size - received < STREAM_CHUNK ? size - received : STREAM_CHUNK;
+		size_t n = socket_receive_bytes(socket, chunk, len);
+		if(n == 0) break;
+		received += n;
+		// Si falla la escritura se sigue leyendo: el flujo tiene que quedar consumido
+		for(size_t written = 0; ok && written < n;) {
+			ssize_t w = write(fd, chunk + written, n - written);
+			if(w <= 0) ok = false;
+			else written += w;
+		}
+	}
+	buffer_release(chunk);
+	return ok && received == size;
+}
+
 void protocol_send_handshake(t_socket socket) {
-	protocol_send_packet(protocol_packet(OP_HANDSHAKE, NULL), socket);
+	t_serial *serial = serial_pack("i", PROTOCOL_VERSION);
+	protocol_send_packet(protocol_packet(OP_HANDSHAKE, serial), socket);
+	serial_destroy(serial);
 }
 
-bool protocol_receive_handshake(t_socket socket, t_process process) {
+t_process protocol_receive_handshake(t_socket socket) {
 	t_packet packet = protocol_receive_packet(socket);
-	bool result = packet.operation == OP_HANDSHAKE && packet.sender == process;
-	serial_destroy(packet.content);
-	return result;
+	int version = -1;
+	if(packet.operation == OP_HANDSHAKE && packet.content->size > 0) serial_unpack(packet.content, "i", &version);
+	else serial_destroy(packet.content);
+	return version == PROTOCOL_VERSION ? packet.sender : PROC_UNDEFINED;
 }
 
 void protocol_send_response(t_socket socket, int code) {
@@ -74,3 +149,34 @@ int protocol_receive_response(t_socket socket) {
 	return code;
 }
 
+// ========== Funciones privadas ==========
+
+static uint64_t receive_header(t_socket socket, t_packet *packet) {
+	memset(packet, 0, sizeof(t_packet));
+	char buffer[HEADER_SIZE];
+	t_layout_header header;
+	if(socket_receive_bytes(socket, buffer, HEADER_SIZE) != HEADER_SIZE
+			|| !layout_header_read(&header, buffer, HEADER_SIZE)) return 0;
+	packet->sender = header.sender;
+	packet->operation = header.operation;
+	packet->trace = header.trace;
+	return packet->operation == OP_UNDEFINED ? 0 : header.size;
+}
+
+static bool receive_content(t_socket socket, t_packet *packet, uint64_t size) {
+	// Un tamaño fuera de rango es un encabezado corrupto o de otra versión: ni se intenta reservarlo
+	if(size > PROTOCOL_MAX_PACKET) {
+		packet->content = serial_create(NULL, 0);
+		return false;
+	}
+
+	// Los datos van a un buffer del pool: se devuelve al destruir el contenido
+	packet->content = serial_create_pooled(size);
+	if(size == 0) return true;
+	if(packet->content->data != NULL && socket_receive_bytes(socket, packet->content->data, size) == size) return true;
+
+	// Un contenido truncado no debe llegar al decodificador como si fuera un paquete válido
+	serial_destroy(packet->content);
+	packet->content = serial_create(NULL, 0);
+	return false;
+}
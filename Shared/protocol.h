@@ -5,9 +5,17 @@
 #include <serial.h>
 #include <socket.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+// Se verifica en el apretón de manos: cambia con el formato de los paquetes
+#define PROTOCOL_VERSION 4
+// Límite para el contenido de un paquete: lo más grande que viaja así es un bloque
+// de datos (1 MiB); los archivos van en flujo y no cuentan
+#define PROTOCOL_MAX_PACKET (64 * 1024 * 1024)
 
 #define RESPONSE_OK 0
 #define RESPONSE_ERROR -1
+#define RESPONSE_CANCELADO -3
 
 typedef enum {
 	OP_UNDEFINED,
@@ -42,6 +50,19 @@ typedef enum {
 
 	OP_MANDAR_ARCHIVO,				// worker -> worker
 
+	OP_SCRIPT_REQUEST,				// worker -> master
+	OP_SCRIPT,						// master -> worker
+
+	OP_INICIAR_TRANSFORMACION_LOTE,	// master -> worker
+	OP_BLOQUE_TRANSFORMADO,			// worker -> master
+	OP_CANCELAR_TRANSFORMACION,		// yama -> master -> worker
+	OP_AMPLIAR_LOTE,				// master -> worker
+	OP_FIN_LOTE,					// master -> worker
+
+	OP_INICIAR_APAREO,				// yama -> master
+	OP_APAREO_PARCIAL,				// master -> worker
+	OP_APAREO_LISTO,				// master -> yama
+
 } t_operation;
 
 //interrupciones del job
@@ -58,6 +79,7 @@ enum{FS_NO_ESTABLE = -1,
 typedef struct {
 	t_process sender;		// Proceso remitente
 	t_operation operation;	// Operación a realizar
+	int trace;				// Job del remitente, para las trazas (0 si no hay)
 	t_serial *content;		// Contenido serializado
 } t_packet;
 
@@ -77,9 +99,56 @@ t_packet protocol_packet(t_operation operation, t_serial *content);
  */
 bool protocol_send_packet(t_packet packet, t_socket socket);
 
+/**
+ * Envía una operación cuyo contenido está repartido en varios segmentos de
+ * memoria (por ejemplo un archivo mapeado), sin serializarlo en un buffer.
+ * El encabezado y los segmentos salen en una sola llamada al sistema.
+ * @param socket Descriptor del socket.
+ * @param operation Operación a realizar.
+ * @param body Segmentos que forman el contenido, ya serializados.
+ * @param count Cantidad de segmentos.
+ * @return Valor lógico indicando si se pudo enviar el paquete.
+ */
+bool protocol_send_iov(t_socket socket, t_operation operation, const struct iovec *body, int count);
+
+/**
+ * Envía una operación con un contenido de cualquier tamaño leído de un
+ * descriptor, sin cargarlo entero en memoria. El contenido son metadatos
+ * serializados seguidos de los bytes crudos, que pueden incluir '\0'.
+ * @param socket Descriptor del socket.
+ * @param operation Operación a realizar.
+ * @param meta Metadatos serializados (puede ser NULL).
+ * @param fd Descriptor del que se leen los bytes, desde su posición actual.
+ * @param size Cantidad de bytes a enviar desde fd.
+ * @return Valor lógico indicando si se pudo enviar el paquete completo.
+ */
+bool protocol_send_stream(t_socket socket, t_operation operation, t_serial *meta, int fd, uint64_t size);
+
+/**
+ * Recibe un paquete enviado con protocol_send_stream.
+ * Solo lee los metadatos: los bytes crudos quedan en el socket y deben
+ * consumirse con protocol_receive_file.
+ * @param socket Descriptor del socket.
+ * @param size Se carga con la cantidad de bytes crudos pendientes.
+ * @return Paquete cuyo contenido son los metadatos.
+ */
+t_packet protocol_receive_stream(t_socket socket, uint64_t *size);
+
+/**
+ * Recibe los bytes crudos de un flujo y los escribe en un descriptor.
+ * @param socket Descriptor del socket.
+ * @param fd Descriptor destino (-1 para descartarlos).
+ * @param size Cantidad de bytes pendientes (de protocol_receive_stream).
+ * @return Valor lógico indicando si se recibió y escribió todo.
+ */
+bool protocol_receive_file(t_socket socket, int fd, uint64_t size);
+
 /**
  * Recibe un paquete de un determinado socket.
- * Si se recibe contenido, luego de usarlo debe ser liberado con free().
+ * El contenido usa un buffer del pool: luego de usarlo debe liberarse con
+ * serial_destroy() (o serial_unpack()), nunca con free() sobre los datos.
+ * Si el contenido supera PROTOCOL_MAX_PACKET o llega incompleto, la
+ * operación es OP_UNDEFINED (como si se hubiera cerrado la conexión).
  * @param socket Descriptor del socket.
  * @return Paquete.
  */
@@ -92,12 +161,11 @@ t_packet protocol_receive_packet(t_socket socket);
 void protocol_send_handshake(t_socket socket);
 
 /**
- * Recibe un apretón de manos y verifica que sea del proceso que corresponda.
+ * Recibe un apretón de manos y verifica que sea de la misma versión del protocolo.
  * @param socket Descriptor del socket.
- * @param process Proceso del que se espera recibir el apretón de manos.
- * @return Valor lógico indicando si se recibió correctamente.
+ * @return Proceso remitente, o PROC_UNDEFINED si no llegó un apretón de manos válido.
  */
-bool protocol_receive_handshake(t_socket socket, t_process process);
+t_process protocol_receive_handshake(t_socket socket);
 
 /**
  * Envía un código de respuesta a un socket.
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <mstring.h>
+#include "buffer.h"
 #include "serial.h"
 
 // macros for packing floats and doubles:
@@ -20,10 +21,12 @@
 #define unpack754_32(i) (unpack754((i), 32, 8))
 #define unpack754_64(i) (unpack754((i), 64, 11))
 
-static char *null_string = "__NULL__";
+static char *null_string = SERIAL_NULL_STRING;
 
 static void add_variadic(t_serial *serial, const char *format, va_list ap);
-static void remove_variadic(t_serial *serial, const char *format, va_list ap);
+static void read_variadic(t_serial_reader *reader, const char *format, va_list ap);
+static void consume(t_serial *serial, size_t size);
+static void release_data(t_serial *serial);
 
 static unsigned long long int pack754(long double f, unsigned bits, unsigned expbits);
 static long double unpack754(unsigned long long int i, unsigned bits, unsigned expbits);
@@ -43,6 +46,7 @@ t_serial *serial_create(void *data, size_t size) {
 	t_serial *serial = malloc(sizeof(t_serial));
 	serial->data = data;
 	serial->size = size;
+	serial->pooled = false;
 	if(data == NULL && size > 0) {
 		serial->data = malloc(size);
 	}
@@ -66,10 +70,27 @@ void serial_add(t_serial *serial, const char *format, ...) {
 }
 
 void serial_remove(t_serial *serial, const char *format, ...) {
+	t_serial_reader reader = serial_reader(serial);
 	va_list ap;
 	va_start(ap, format);
-	remove_variadic(serial, format, ap);
+	read_variadic(&reader, format, ap);
 	va_end(ap);
+	consume(serial, reader.offset);
+}
+
+t_serial_reader serial_reader(t_serial *serial) {
+	return (t_serial_reader) {serial, 0};
+}
+
+void serial_read(t_serial_reader *reader, const char *format, ...) {
+	va_list ap;
+	va_start(ap, format);
+	read_variadic(reader, format, ap);
+	va_end(ap);
+}
+
+size_t serial_remaining(const t_serial_reader *reader) {
+	return reader->offset < reader->serial->size ? reader->serial->size - reader->offset : 0;
 }
 
 t_serial *serial_pack(const char *format, ...) {
@@ -82,15 +103,27 @@ t_serial *serial_pack(const char *format, ...) {
 }
 
 void serial_unpack(t_serial *serial, const char *format, ...) {
+	// El contenedor se destruye al final: no hace falta removerle nada
+	t_serial_reader reader = serial_reader(serial);
 	va_list ap;
 	va_start(ap, format);
-	remove_variadic(serial, format, ap);
+	read_variadic(&reader, format, ap);
 	va_end(ap);
 	serial_destroy(serial);
 }
 
+t_serial *serial_create_pooled(size_t size) {
+	t_serial *serial = serial_create(NULL, 0);
+	if(size > 0) {
+		serial->data = buffer_get(size);
+		serial->size = size;
+		serial->pooled = true;
+	}
+	return serial;
+}
+
 void serial_destroy(t_serial *serial) {
-	free(serial->data);
+	release_data(serial);
 	free(serial);
 }
 
@@ -213,27 +246,35 @@ static void add_variadic(t_serial *serial, const char *format, va_list ap) {
 			strncpy(buf, ps, len);
 			break;
 
-		case 'x': // binary
+		case 'x': // binary, con prefijo de longitud de 64 bits
 			x = va_arg(ap, t_serial*);
-			len = 4 + x->size;
+			len = 8 + x->size;
 			resize_buffer();
-			packi32((unsigned char *)buf, x->size);
-			memcpy(buf + 4, x->data, x->size);
+			packi64((unsigned char *)buf, x->size);
+			memcpy(buf + 8, x->data, x->size);
 		}
 
 		buf += len;
 	}
 
 	size_t added_size = buf - buffer;
-	serial->data = realloc(serial->data, serial->size + added_size);
+	if(serial->pooled) {
+		// Un buffer del pool no se puede redimensionar: se pasa a memoria propia
+		void *data = malloc(serial->size + added_size);
+		memcpy(data, serial->data, serial->size);
+		release_data(serial);
+		serial->data = data;
+	} else {
+		serial->data = realloc(serial->data, serial->size + added_size);
+	}
 	memcpy(serial->data + serial->size, buffer, added_size);
 	serial->size += added_size;
 	free(buffer);
 }
 
-static void remove_variadic(t_serial *serial, const char *format, va_list ap) {
-	if(serial->size <= 0) return;
-	char *buf = serial->data;
+static void read_variadic(t_serial_reader *reader, const char *format, va_list ap) {
+	if(serial_remaining(reader) == 0) return;
+	char *buf = (char*)reader->serial->data + reader->offset;
 
 	signed char *c;
 	unsigned char *C;
@@ -321,22 +362,15 @@ static void remove_variadic(t_serial *serial, const char *format, va_list ap) {
 
 		case 's': // string
 			s = va_arg(ap, char**);
-			char *str = mstring_duplicate(buf);
-			len = strlen(str) + 1;
-			*s = str;
-			if(mstring_equal(str, null_string)) {
-				*s = NULL;
-				free(str);
-			}
+			len = strlen(buf) + 1;
+			*s = mstring_equal(buf, null_string) ? NULL : mstring_duplicate(buf);
 			buf += len;
 			break;
 
-		case 'x': // binary
+		case 'x': // binary, con prefijo de longitud de 64 bits
 			x = va_arg(ap, t_serial**);
-			t_serial *isr = malloc(sizeof(t_serial));
-			isr->size = unpacki32((unsigned char *)buf);
-			isr->data = malloc(isr->size);
-			buf += 4;
+			t_serial *isr = serial_create(NULL, unpacku64((unsigned char *)buf));
+			buf += 8;
 			memcpy(isr->data, buf, isr->size);
 			*x = isr;
 			buf += isr->size;
@@ -344,21 +378,26 @@ static void remove_variadic(t_serial *serial, const char *format, va_list ap) {
 		}
 	}
 
-	size_t removed_size = buf - (char*)serial->data;
-	serial->size -= removed_size;
+	reader->offset = buf - (char*)reader->serial->data;
+}
 
-	if(serial->size <= 0) {
-		free(serial->data);
-		serial->data = NULL;
+static void consume(t_serial *serial, size_t size) {
+	if(size >= serial->size) {
+		release_data(serial);
+		serial->size = 0;
 		return;
 	}
 
-	buf = serial->data;
-	for(int i = 0; i < serial->size; i++) {
-		*(buf + i) = *(buf + i + removed_size);
-	}
+	// Se conserva el buffer: lo que sobra se libera al destruir el contenedor
+	serial->size -= size;
+	memmove(serial->data, (char*)serial->data + size, serial->size);
+}
 
-	serial->data = realloc(serial->data, serial->size);
+static void release_data(t_serial *serial) {
+	if(serial->pooled) buffer_release(serial->data);
+	else free(serial->data);
+	serial->data = NULL;
+	serial->pooled = false;
 }
 
 /*
@@ -1,14 +1,24 @@
 #ifndef SERIAL_H_
 #define SERIAL_H_
 
+#include <stdbool.h>
 #include <stddef.h>
 #include "mlist.h"
 
+// Representación de un string NULL en los datos serializados
+#define SERIAL_NULL_STRING "__NULL__"
+
 typedef struct serial {
 	void *data;
 	size_t size;
+	bool pooled;		// Los datos vienen del pool de buffers y vuelven ahí al destruirse
 } t_serial;
 
+typedef struct serial_reader {
+	t_serial *serial;
+	size_t offset;		// Bytes ya leídos desde el inicio de los datos
+} t_serial_reader;
+
 /*
  * Referencias para el formato de serialización:
  * ---
@@ -19,7 +29,8 @@ typedef struct serial {
  * f : float
  * d : double
  * s : string (char*)
- * x : binary (t_serial*)
+ * x : binary (t_serial*), con prefijo de longitud de 64 bits: admite cualquier byte, incluso '\0'
+
  * ---
  * Letra minúscula : signed
  * Letra mayúscula : unsigned
@@ -48,11 +59,34 @@ void serial_add(t_serial *serial, const char *format, ...);
 
 /**
  * Deserializa datos y los remueve de un contenedor serial.
+ * Mueve los datos restantes al inicio: para leer muchos elementos conviene serial_read.
  * @param serial Contenedor serial.
  * @param format Formato de serialización.
  */
 void serial_remove(t_serial *serial, const char *format, ...);
 
+/**
+ * Crea un cursor de lectura al inicio de un contenedor serial.
+ * El contenedor no se modifica mientras se lee.
+ * @param serial Contenedor serial.
+ * @return Cursor de lectura.
+ */
+t_serial_reader serial_reader(t_serial *serial);
+
+/**
+ * Deserializa datos desde la posición del cursor y lo avanza.
+ * @param reader Cursor de lectura.
+ * @param format Formato de serialización.
+ */
+void serial_read(t_serial_reader *reader, const char *format, ...);
+
+/**
+ * Indica cuántos bytes quedan por leer.
+ * @param reader Cursor de lectura.
+ * @return Bytes restantes.
+ */
+size_t serial_remaining(const t_serial_reader *reader);
+
 /*
  * Serializa datos según el formato especificado.
  * @return Datos serializados.
@@ -66,6 +100,13 @@ t_serial *serial_pack(const char *format, ...);
  */
 void serial_unpack(t_serial *serial, const char *format, ...);
 
+/**
+ * Crea una estructura con datos tomados del pool de buffers.
+ * Se usa para recibir paquetes; al destruirla el buffer vuelve al pool.
+ * @param size Tamaño de los datos.
+ */
+t_serial *serial_create_pooled(size_t size);
+
 /**
  * Destruye una estructura de datos serializados.
  * @param serial Estructura serial.
@@ -1,28 +1,64 @@
 #include "socket.h"
 
 #include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <config.h>
 #include <mstring.h>
 #include <thread.h>
 
-#define BACKLOG 5
 #define MAXSIZE 1024
+#define KEEPALIVE_INTERVALO 10	// Segundos entre sondas de keepalive sin respuesta
+#define KEEPALIVE_SONDAS 3		// Sondas sin respuesta antes de dar la conexión por caída
+
+typedef struct {
+	bool nodelay;		// Desactiva Nagle
+	bool quickack;		// ACK inmediato en lugar de demorarlo
+	int buffer;			// SO_SNDBUF y SO_RCVBUF en bytes (0 = los del sistema)
+	int keepalive;		// Segundos de inactividad antes de sondear (0 = sin keepalive)
+} t_profile;
+
+// Valores por omisión, si el archivo de configuración no los define
+static t_profile profiles[] = {
+	[SOCKET_CONTROL] = {true, true, 0, 30},
+	[SOCKET_BULK] = {false, false, 4 * 1024 * 1024, 60}
+};
+static int backlog = 128;
+static int connect_timeout = 5000;		// Milisegundos (0 = el del sistema)
+static bool quickack_fds[FD_SETSIZE];	// TCP_QUICKACK no es permanente: se rearma en cada recepción
+static pthread_once_t profiles_loaded = PTHREAD_ONCE_INIT;
+#ifndef IOV_MAX
+#define IOV_MAX 1024	// Mínimo que garantiza Linux para sendmsg
+#endif
 
 static void check_descriptor(int descriptor);
 static struct addrinfo *create_addrinfo(const char *ip, const char *port);
 static t_socket create_socket(struct addrinfo *addr);
+static int connect_socket(t_socket sockfd, struct addrinfo *addr);
+static void load_profiles(void);
+static void load_profile(t_profile *profile, const char *name);
+static int config_int(const char *property, int value);
 static size_t sendall(t_socket sockfd, const void *buf, size_t len);
 static size_t recvall(t_socket sockfd, void *buf, size_t len);
 
 // ========== Public functions ==========
 
 t_socket socket_init(const char *ip, const char *port) {
+	return socket_init_profile(ip, port, SOCKET_CONTROL);
+}
+
+t_socket socket_init_profile(const char *ip, const char *port, t_socket_profile profile) {
 	struct addrinfo *cur, *addr = create_addrinfo(ip, port);
 	t_socket sockfd = -1;
 	int ret = -1;
@@ -30,11 +66,13 @@ t_socket socket_init(const char *ip, const char *port) {
 	for(cur = addr; cur != NULL; cur = cur->ai_next) {
 		sockfd = create_socket(cur);
 		if(sockfd == -1) continue;
+		// Antes de conectar o escuchar, para que los buffers definan la ventana de TCP
+		socket_set_profile(sockfd, profile);
 
 		if(ip == NULL) {
 			ret = bind(sockfd, cur->ai_addr, cur->ai_addrlen);
 		} else {
-			ret = connect(sockfd, cur->ai_addr, cur->ai_addrlen);
+			ret = connect_socket(sockfd, cur);
 		}
 
 		if(ret != -1) break;
@@ -43,13 +81,13 @@ t_socket socket_init(const char *ip, const char *port) {
 
 	freeaddrinfo(addr);
 
-	if((sockfd == -1 || ret == -1) && (errno == ENOTCONN || errno == EBADF)) return -1;
+	// Un servidor caído o que no responde a tiempo no es un error fatal para quien conecta:
+	// se devuelve -1 para que decida (Master, por ejemplo, lo informa a YAMA para replanificar)
+	if(ip != NULL) return ret == -1 ? -1 : sockfd;
+
 	check_descriptor(sockfd);
 	check_descriptor(ret);
-
-	if(ip == NULL) {
-		check_descriptor(listen(sockfd, BACKLOG));
-	}
+	check_descriptor(listen(sockfd, backlog));
 
 	return sockfd;
 }
@@ -67,6 +105,9 @@ t_socket socket_accept(t_socket sv_sock) {
 	socklen_t addr_size = sizeof rem_addr;
 
 	t_socket cli_sock = accept(sv_sock, &rem_addr, &addr_size);
+	if(cli_sock >= 0 && cli_sock < FD_SETSIZE && sv_sock >= 0 && sv_sock < FD_SETSIZE) {
+		quickack_fds[cli_sock] = quickack_fds[sv_sock];
+	}
 	return cli_sock;
 }
 
@@ -74,10 +115,114 @@ t_socket socket_connect(const char *ip, const char *port) {
 	return socket_init(ip, port);
 }
 
+t_socket socket_connect_profile(const char *ip, const char *port, t_socket_profile profile) {
+	return socket_init_profile(ip, port, profile);
+}
+
+t_socket socket_connect_async(const char *ip, const char *port, t_socket_profile profile) {
+	struct addrinfo *addr = create_addrinfo(ip, port);
+	if(addr == NULL) return -1;
+
+	t_socket sockfd = create_socket(addr);
+	if(sockfd != -1) {
+		socket_set_profile(sockfd, profile);
+		socket_set_blocking(sockfd, false);
+		if(connect(sockfd, addr->ai_addr, addr->ai_addrlen) == -1 && errno != EINPROGRESS) {
+			socket_close(sockfd);
+			sockfd = -1;
+		}
+	}
+
+	freeaddrinfo(addr);
+	return sockfd;
+}
+
+int socket_connect_result(t_socket sockfd) {
+	int error = 0;
+	socklen_t len = sizeof error;
+	if(getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &len) == -1) return errno;
+	return error;
+}
+
+int socket_connect_timeout() {
+	pthread_once(&profiles_loaded, load_profiles);
+	return connect_timeout;
+}
+
+void socket_set_blocking(t_socket sockfd, bool blocking) {
+	int flags = fcntl(sockfd, F_GETFL);
+	fcntl(sockfd, F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK);
+}
+
+void socket_set_profile(t_socket sockfd, t_socket_profile profile) {
+	pthread_once(&profiles_loaded, load_profiles);
+	t_profile *p = &profiles[profile];
+
+	int nodelay = p->nodelay;
+	setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof nodelay);
+	int quickack = p->quickack;
+	setsockopt(sockfd, IPPROTO_TCP, TCP_QUICKACK, &quickack, sizeof quickack);
+	if(sockfd >= 0 && sockfd < FD_SETSIZE) quickack_fds[sockfd] = p->quickack;
+
+	if(p->buffer > 0) {
+		setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &p->buffer, sizeof p->buffer);
+		setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &p->buffer, sizeof p->buffer);
+	}
+
+	int keepalive = p->keepalive > 0;
+	setsockopt(sockfd, SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof keepalive);
+	if(keepalive) {
+		int interval = KEEPALIVE_INTERVALO, probes = KEEPALIVE_SONDAS;
+		setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPIDLE, &p->keepalive, sizeof p->keepalive);
+		setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof interval);
+		setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof probes);
+	}
+}
+
 size_t socket_send_bytes(t_socket sockfd, const char *message, size_t size) {
 	return sendall(sockfd, message, size);
 }
 
+size_t socket_send_iov(t_socket sockfd, const struct iovec *iov, int count) {
+	// Copia local: los envíos parciales van recortando los segmentos
+	struct iovec pending[count];
+	memcpy(pending, iov, count * sizeof(struct iovec));
+	struct iovec *cur = pending;
+	size_t bytes_sent = 0;
+
+	while(count > 0) {
+		if(cur->iov_len == 0) {
+			cur++;
+			count--;
+			continue;
+		}
+		struct msghdr msg;
+		memset(&msg, 0, sizeof msg);
+		msg.msg_iov = cur;
+		msg.msg_iovlen = count < IOV_MAX ? count : IOV_MAX;
+
+		ssize_t n;
+		do {
+			n = sendmsg(sockfd, &msg, MSG_NOSIGNAL);
+		} while(n == -1 && errno == EINTR && thread_active());
+		if(n == -1 && errno == EPIPE) break;
+		check_descriptor(n);
+		bytes_sent += n;
+
+		while(count > 0 && (size_t) n >= cur->iov_len) {
+			n -= cur->iov_len;
+			cur++;
+			count--;
+		}
+		if(count > 0) {
+			cur->iov_base = (char*) cur->iov_base + n;
+			cur->iov_len -= n;
+		}
+	}
+
+	return bytes_sent;
+}
+
 size_t socket_receive_bytes(t_socket sockfd, char *message, size_t size) {
 	return recvall(sockfd, message, size);
 }
@@ -146,6 +291,19 @@ t_fdset socket_select(t_fdset fds) {
 	return sfds;
 }
 
+t_fdset socket_select_timeout(t_fdset fds, int timeout) {
+	t_fdset sfds = fds;
+	struct timeval tv = { timeout / 1000, (timeout % 1000) * 1000 };
+	int r;
+	sel: r = select(sfds.max + 1, &sfds.set, NULL, NULL, &tv);
+	if(r == -1 && errno == EINTR) {
+		sfds = fds;
+		goto sel;
+	}
+	check_descriptor(r);
+	return sfds;
+}
+
 void socket_close(t_socket sockfd) {
 	shutdown(sockfd, SHUT_RDWR);
 	close(sockfd);
@@ -174,6 +332,7 @@ static struct addrinfo *create_addrinfo(const char *ip, const char *port) {
 	int status = getaddrinfo(ip, port, &hints, &addr);
 	if(status != 0) {
 		fprintf(stderr, "%s\n", gai_strerror(status));
+		addr = NULL;
 	}
 
 	return addr;
@@ -190,6 +349,57 @@ static t_socket create_socket(struct addrinfo *addr) {
 	return sockfd;
 }
 
+static int connect_socket(t_socket sockfd, struct addrinfo *addr) {
+	if(connect_timeout <= 0) return connect(sockfd, addr->ai_addr, addr->ai_addrlen);
+
+	// Conexión no bloqueante para poder cortarla si el servidor no responde a tiempo
+	int flags = fcntl(sockfd, F_GETFL);
+	fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+	int ret = connect(sockfd, addr->ai_addr, addr->ai_addrlen);
+	if(ret == -1 && errno == EINPROGRESS) {
+		struct pollfd fd = {sockfd, POLLOUT, 0};
+		int error = 0;
+		socklen_t len = sizeof error;
+		if(poll(&fd, 1, connect_timeout) == 1 && getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0) {
+			ret = 0;
+		} else {
+			errno = error != 0 ? error : ETIMEDOUT;
+		}
+	}
+	fcntl(sockfd, F_SETFL, flags);
+	return ret;
+}
+
+static void load_profiles() {
+	backlog = config_int("TCP_BACKLOG", backlog);
+	connect_timeout = config_int("TCP_CONNECT_TIMEOUT", connect_timeout);
+	load_profile(&profiles[SOCKET_CONTROL], "CONTROL");
+	load_profile(&profiles[SOCKET_BULK], "BULK");
+}
+
+static void load_profile(t_profile *profile, const char *name) {
+	char *property(const char *option) {
+		return mstring_create("TCP_%s_%s", name, option);
+	}
+	char *nodelay = property("NODELAY");
+	char *quickack = property("QUICKACK");
+	char *buffer = property("BUFFER");
+	char *keepalive = property("KEEPALIVE");
+	profile->nodelay = config_int(nodelay, profile->nodelay);
+	profile->quickack = config_int(quickack, profile->quickack);
+	profile->buffer = config_int(buffer, profile->buffer);
+	profile->keepalive = config_int(keepalive, profile->keepalive);
+	free(nodelay);
+	free(quickack);
+	free(buffer);
+	free(keepalive);
+}
+
+static int config_int(const char *property, int value) {
+	const char *str = config_get(property);
+	return str == NULL ? value : atoi(str);
+}
+
 static size_t sendall(t_socket sockfd, const void *buf, size_t len) {
 	size_t bytes_sent = 0;
 
@@ -215,6 +425,10 @@ static size_t recvall(t_socket sockfd, void *buf, size_t len) {
 			n = recv(sockfd, buf + bytes_received, len - bytes_received, 0);
 		} while(n == -1 && errno == EINTR && thread_active());
 		if(n == -1) return 0;
+		if(n > 0 && sockfd < FD_SETSIZE && quickack_fds[sockfd]) {
+			int quickack = 1;
+			setsockopt(sockfd, IPPROTO_TCP, TCP_QUICKACK, &quickack, sizeof quickack);
+		}
 		bytes_received += n;
 		if(n == 0 || (len == MAXSIZE && ((char*)buf)[bytes_received - 1] == '\0')) {
 			break;
@@ -3,11 +3,24 @@
 
 #include <sys/types.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #include <stddef.h>
 #include <stdbool.h>
 
 typedef int t_socket;
 
+/*
+ * Perfiles de opciones TCP, configurables en el archivo del proceso:
+ * ---
+ * SOCKET_CONTROL : pedidos y respuestas chicos (sin Nagle, ACK inmediato)
+ * SOCKET_BULK : bloques y archivos (buffers grandes)
+ * ---
+ */
+typedef enum {
+	SOCKET_CONTROL,
+	SOCKET_BULK
+} t_socket_profile;
+
 typedef struct {
     fd_set set;
     t_socket max;
@@ -23,6 +36,16 @@ typedef struct {
  */
 t_socket socket_init(const char *ip, const char *port);
 
+/**
+ * Igual que socket_init, con un perfil de opciones TCP determinado.
+ * Los sockets aceptados por un socket de escucha heredan su perfil.
+ * @param ip Dirección IP del servidor (NULL para escuchar).
+ * @param port Puerto.
+ * @param profile Perfil de opciones.
+ * @return Descriptor del socket.
+ */
+t_socket socket_init_profile(const char *ip, const char *port, t_socket_profile profile);
+
 /**
  * Crea un socket de servidor para conectarse con un cliente a través de un
  * puerto determinado.
@@ -48,6 +71,54 @@ t_socket socket_accept(t_socket sv_sock);
  */
 t_socket socket_connect(const char *ip, const char *port);
 
+/**
+ * Igual que socket_connect, con un perfil de opciones TCP determinado.
+ * @param ip Dirección IP del servidor.
+ * @param port Puerto del servidor.
+ * @param profile Perfil de opciones.
+ * @return Descriptor del socket del servidor.
+ */
+t_socket socket_connect_profile(const char *ip, const char *port, t_socket_profile profile);
+
+/**
+ * Empieza a conectarse con un servidor sin esperar a que responda.
+ * El socket queda no bloqueante: cuando se puede escribir en él, la conexión
+ * terminó y su resultado se consulta con socket_connect_result().
+ * @param ip Dirección IP del servidor.
+ * @param port Puerto del servidor.
+ * @param profile Perfil de opciones.
+ * @return Descriptor del socket (-1 si no se pudo ni empezar a conectar).
+ */
+t_socket socket_connect_async(const char *ip, const char *port, t_socket_profile profile);
+
+/**
+ * Devuelve el resultado de una conexión empezada con socket_connect_async().
+ * @param sockfd Descriptor del socket.
+ * @return 0 si se conectó, o el código de error (como en errno).
+ */
+int socket_connect_result(t_socket sockfd);
+
+/**
+ * Devuelve cuánto se espera como máximo a que un servidor acepte una conexión.
+ * @return Milisegundos (TCP_CONNECT_TIMEOUT; 0 si se usa el del sistema).
+ */
+int socket_connect_timeout(void);
+
+/**
+ * Hace que las operaciones sobre un socket bloqueen o no.
+ * @param sockfd Descriptor del socket.
+ * @param blocking Si las operaciones bloquean.
+ */
+void socket_set_blocking(t_socket sockfd, bool blocking);
+
+/**
+ * Cambia el perfil de opciones TCP de un socket ya conectado.
+ * Los tamaños de buffer solo rinden del todo si se fijan antes de conectar.
+ * @param sockfd Descriptor del socket.
+ * @param profile Perfil de opciones.
+ */
+void socket_set_profile(t_socket sockfd, t_socket_profile profile);
+
 /**
  * Envía datos binarios por una conexión abierta en un determinado socket.
  * @param sockfd Descriptor del socket.
@@ -57,6 +128,16 @@ t_socket socket_connect(const char *ip, const char *port);
  */
 size_t socket_send_bytes(t_socket sockfd, const char *message, size_t size);
 
+/**
+ * Envía varios segmentos de memoria como un único flujo de datos, sin
+ * copiarlos a un buffer intermedio (sendmsg con scatter-gather).
+ * @param sockfd Descriptor del socket.
+ * @param iov Segmentos a enviar, en orden.
+ * @param count Cantidad de segmentos.
+ * @return Número de bytes enviados.
+ */
+size_t socket_send_iov(t_socket sockfd, const struct iovec *iov, int count);
+
 /**
  * Recibe datos binarios por una conexión abierta en un determinado socket.
  * @param sockfd Descriptor del socket.
@@ -131,6 +212,14 @@ char *socket_port(t_socket sock);
  */
 t_fdset socket_select(t_fdset fds);
 
+/**
+ * Realiza un select() que espera como máximo el tiempo indicado.
+ * @param sockets Set de sockets.
+ * @param timeout Milisegundos a esperar.
+ * @return Sockets seleccionados (ninguno si se cumplió el tiempo).
+ */
+t_fdset socket_select_timeout(t_fdset fds, int timeout);
+
 /**
  * Cierra un socket abierto con socket_listen() o socket_connect().
  * @param sockfd Descriptor del socket a cerrar.
@@ -38,11 +38,12 @@ mlist_t *list_transformacion_unpack(t_serial *serial) {
 	mlist_t *list = mlist_create();
 
 	int numblocks;
-	serial_remove(serial, "i", &numblocks);
+	t_serial_reader reader = serial_reader(serial);
+	serial_read(&reader, "i", &numblocks);
 
 	while(numblocks--) {
 		tEtapaTransformacion *et = malloc(sizeof(tEtapaTransformacion));
-		serial_remove(serial,"sssiis",&et->nodo,
+		serial_read(&reader,"sssiis",&et->nodo,
 				&et->ip,
 				&et->puerto,
 				&et->bloque,
@@ -50,7 +51,7 @@ mlist_t *list_transformacion_unpack(t_serial *serial) {
 				&et->archivo_etapa);
 		mlist_append(list, et);
 	}
-
+	serial_destroy(serial);
 	return list;
 }
 
@@ -131,6 +132,13 @@ void mandar_etapa_rl(tEtapaReduccionLocal* rl,t_socket sock){
 	serial_destroy(serial);
 }
 
+void mandar_etapa_apareo(tEtapaReduccionLocal* apareo,t_socket sock){
+	t_serial *serial = etapa_rl_pack(apareo);
+	t_packet paquete = protocol_packet(OP_INICIAR_APAREO, serial);
+	protocol_send_packet(paquete, sock);
+	serial_destroy(serial);
+}
+
 /*
  * **************************************************************************************FIN FUNCIONES
  * **************************************************************************************ETAPA REDUCCION LOCAL
@@ -190,11 +198,12 @@ mlist_t *list_reduccionGlobal_unpack(t_serial *serial) {
 	mlist_t *list = mlist_create();
 
 	int numblocks;
-	serial_remove(serial, "i", &numblocks);
+	t_serial_reader reader = serial_reader(serial);
+	serial_read(&reader, "i", &numblocks);
 
 	while(numblocks--) {
 		tEtapaReduccionGlobal *rg = malloc(sizeof(tEtapaReduccionGlobal));
-		serial_remove(serial, "ssssss",
+		serial_read(&reader, "ssssss",
 				&rg->nodo,
 				&rg->ip,
 				&rg->puerto,
@@ -203,7 +212,7 @@ mlist_t *list_reduccionGlobal_unpack(t_serial *serial) {
 				&rg->encargado);
 		mlist_append(list, rg);
 	}
-
+	serial_destroy(serial);
 	return list;
 }
 
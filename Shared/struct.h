@@ -65,6 +65,9 @@ tEtapaReduccionLocal* new_etapa_rl(const char*nodo,const char*ip,const char*puer
 t_serial *etapa_rl_pack(tEtapaReduccionLocal*);
 tEtapaReduccionLocal* etapa_rl_unpack(t_serial*);
 void mandar_etapa_rl(tEtapaReduccionLocal*,t_socket);
+/* Un apareo parcial tiene la misma forma que una reducción local: junta en archivo_etapa
+ * salidas de transformación ya terminadas, pero sin aplicar el script de reducción */
+void mandar_etapa_apareo(tEtapaReduccionLocal*,t_socket);
 /* Como no pude serializar y deserializar una lista, decidi meter en un string todos los directorios que se encuentra en etapa_temporal y de ahí ver si esta
  * el archivo que queremos
  * @param1: cadena con los directorios de todos los archivos (se obtiene de etapa_rl_unpack
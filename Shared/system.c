@@ -64,7 +64,7 @@ char *system_lpath(const char *path) {
 
 void system_init() {
 	path_mkdir(system_userdir());
-	char *dirs[] = {"config", "logs", "tmp", "metadata/archivos", "metadata/bitmaps", NULL};
+	char *dirs[] = {"config", "logs", "logs/trazas", "tmp", "metadata/archivos", "metadata/bitmaps", NULL};
 
 	for(char **dir = dirs; *dir != NULL; dir++) {
 		char *path = mstring_create("%s/%s", system_userdir(), *dir);
@@ -0,0 +1,125 @@
+#include "trace.h"
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mstring.h>
+#include <process.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <system.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TRACE_DETAIL 256
+#define TRACE_LINE 1024
+
+static bool enabled = false;
+static atomic_int process_trace = 0;
+static atomic_int described = 0;		// Último job en el que se escribió el nombre del proceso
+static __thread int thread_trace = 0;
+static char program[64] = "";
+
+static int open_trace(int trace);
+static void escape(const char *source, char *target, size_t size);
+
+// ========== Funciones públicas ==========
+
+void trace_init() {
+	const char *valor = config_get("TRAZAS");
+	enabled = valor != NULL && mstring_toint(valor) != 0;
+	const char *node = process_node() == NULL ? "" : process_node();
+	snprintf(program, sizeof program, "%s%s", process_name(process_current()), node);
+}
+
+void trace_job(int job) {
+	atomic_store(&process_trace, job);
+}
+
+void trace_set(int trace) {
+	thread_trace = trace;
+}
+
+int trace_current() {
+	return thread_trace != 0 ? thread_trace : atomic_load_explicit(&process_trace, memory_order_relaxed);
+}
+
+uint64_t trace_now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void trace_span(const char *name, uint64_t start, uint64_t end, const char *format, ...) {
+	int trace = trace_current();
+	if(!enabled || trace == 0) return;
+
+	char detail[TRACE_DETAIL], escaped[TRACE_DETAIL * 2];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(detail, sizeof detail, format, args);
+	va_end(args);
+	escape(detail, escaped, sizeof escaped);
+
+	// Todo el tramo va en un solo write: con O_APPEND no se mezcla con el de otro proceso
+	char line[TRACE_LINE * 2];
+	int length = 0;
+	int pid = getpid();
+	if(atomic_exchange(&described, trace) != trace) {
+		length = snprintf(line, TRACE_LINE,
+				"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}},\n", pid, program);
+	}
+	length += snprintf(line + length, TRACE_LINE,
+			"{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":%d,\"tid\":%ld,\"args\":{\"detalle\":\"%s\"}},\n",
+			name, program, (unsigned long long) start, (unsigned long long)(end > start ? end - start : 0),
+			pid, (long) syscall(SYS_gettid), escaped);
+	if(length >= (int) sizeof line) length = sizeof line - 1;
+
+	int fd = open_trace(trace);
+	if(fd == -1) return;
+	ssize_t written = write(fd, line, length);
+	(void) written;
+	close(fd);
+}
+
+// ========== Funciones privadas ==========
+
+static int open_trace(int trace) {
+	char *path = mstring_create("%s/logs/trazas/job%d.json", system_userdir(), trace);
+	int fd = open(path, O_WRONLY | O_APPEND | O_CLOEXEC);
+	if(fd == -1 && errno == ENOENT) {
+		// El archivo aparece con el '[' ya escrito: se arma aparte y se enlaza con su nombre final.
+		// Si otro proceso lo enlazó antes, link falla con EEXIST y se usa el suyo
+		char *temp = mstring_create("%s.%d.%ld", path, getpid(), (long) syscall(SYS_gettid));
+		int tfd = open(temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if(tfd != -1) {
+			ssize_t written = write(tfd, "[\n", 2);
+			(void) written;
+			close(tfd);
+			link(temp, path);
+			unlink(temp);
+		}
+		free(temp);
+		fd = open(path, O_WRONLY | O_APPEND | O_CLOEXEC);
+	}
+	free(path);
+	return fd;
+}
+
+static void escape(const char *source, char *target, size_t size) {
+	size_t j = 0;
+	for(const char *c = source; *c != '\0' && j + 7 < size; c++) {
+		if(*c == '"' || *c == '\\') {
+			target[j++] = '\\';
+			target[j++] = *c;
+		} else if((unsigned char) *c < 0x20) {
+			j += snprintf(target + j, size - j, "\\u%04x", *c);
+		} else {
+			target[j++] = *c;
+		}
+	}
+	target[j] = '\0';
+}
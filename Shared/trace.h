@@ -0,0 +1,60 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+
+/*
+ * Trazas de jobs en formato Chrome trace (se abren con Perfetto o chrome://tracing).
+ * El contexto de traza es el número de job: viaja en el encabezado de cada
+ * paquete con el valor del hilo que lo manda, y quien atiende una tarea lo
+ * adopta con trace_set(packet.trace). Cada proceso agrega sus tramos a
+ * logs/trazas/job<N>.json, un archivo por job compartido por todos los
+ * procesos del mismo equipo (cada tramo es una línea escrita de una vez).
+ * ---
+ * El archivo no lleva el ']' final, que es opcional en el formato: así
+ * cualquier proceso puede seguir agregando tramos sin reescribirlo.
+ * Se desactiva con TRAZAS=0 en el archivo de configuración.
+ */
+
+/**
+ * Inicializa las trazas del proceso actual.
+ */
+void trace_init(void);
+
+/**
+ * Fija el job de todo el proceso, para los hilos que no adoptaron otro.
+ * Lo usa Master, que atiende un único job.
+ * @param job Número de job.
+ */
+void trace_job(int job);
+
+/**
+ * Fija el job del hilo actual (0 para ninguno).
+ * @param trace Número de job, normalmente el recibido en un paquete.
+ */
+void trace_set(int trace);
+
+/**
+ * Devuelve el job del hilo actual (o el del proceso si el hilo no tiene).
+ * @return Número de job, 0 si no hay ninguno.
+ */
+int trace_current(void);
+
+/**
+ * Devuelve el instante actual para marcar el inicio de un tramo.
+ * Usa el reloj de pared, para que los tramos de distintos procesos se alineen.
+ * @return Instante en microsegundos.
+ */
+uint64_t trace_now(void);
+
+/**
+ * Registra un tramo del job del hilo actual. Sin job no se registra nada.
+ * @param name Nombre del tramo (planificacion, transformacion, sort...).
+ * @param start Inicio, obtenido con trace_now().
+ * @param end Fin, obtenido con trace_now().
+ * @param format Detalle del tramo, como en printf.
+ */
+void trace_span(const char *name, uint64_t start, uint64_t end, const char *format, ...)
+		__attribute__((format(printf, 4, 5)));
+
+#endif /* TRACE_H_ */
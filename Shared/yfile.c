@@ -54,11 +54,12 @@ t_serial *yfile_pack(t_yfile *file) {
 
 t_yfile *yfile_unpack(t_serial *serial) {
 	t_yfile *file = yfile_create(NULL, 0);
-	serial_remove(serial, "sii", &file->path, &file->size, &file->type);
+	t_serial_reader reader = serial_reader(serial);
+	serial_read(&reader, "sii", &file->path, &file->size, &file->type);
 
-	while(serial->size > 0) {
+	while(serial_remaining(&reader) > 0) {
 		t_block *block = malloc(sizeof(t_block));
-		serial_remove(serial, "iiisis", &block->index, &block->size,
+		serial_read(&reader, "iiisis", &block->index, &block->size,
 				&block->copies[0].blockno, &block->copies[0].node,
 				&block->copies[1].blockno, &block->copies[1].node);
 		mlist_append(file->blocks, block);
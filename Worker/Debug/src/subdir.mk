@@ -5,15 +5,30 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../src/Worker.c \
-../src/funcionesWorker.c 
+../src/codec.c \
+../src/funcionesWorker.c \
+../src/pool.c \
+../src/scheduler.c \
+../src/scripts.c \
+../src/session.c 
 
 OBJS += \
 ./src/Worker.o \
-./src/funcionesWorker.o 
+./src/codec.o \
+./src/funcionesWorker.o \
+./src/pool.o \
+./src/scheduler.o \
+./src/scripts.o \
+./src/session.o 
 
 C_DEPS += \
 ./src/Worker.d \
-./src/funcionesWorker.d 
+./src/codec.d \
+./src/funcionesWorker.d \
+./src/pool.d \
+./src/scheduler.d \
+./src/scripts.d \
+./src/session.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -0,0 +1,208 @@
+#define _GNU_SOURCE
+#include "codec.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <log.h>
+#include <mstring.h>
+#include <trace.h>
+
+typedef struct {
+	const char *extension;
+	const char *program;
+} t_codec;
+
+// lz4 prioriza la velocidad; zstd comprime más a costa de algo de CPU
+static const t_codec codecs[] = {
+	{".lz4", "lz4"},
+	{".zst", "zstd"},
+	{NULL, NULL}
+};
+
+// Archivo abierto como flujo, a través de su compresor si corresponde
+typedef struct {
+	FILE *file;
+	pid_t pid;		// Compresor o descompresor (-1 si el archivo va plano)
+} t_stream;
+
+static bool installed(const char *program);
+static t_stream open_input(const char *path);
+static t_stream open_output(const char *path);
+static bool close_stream(t_stream *stream);
+static bool merge(t_stream *inputs, int count, FILE *output);
+
+// ========== Funciones públicas ==========
+
+const char *codec_program(const char *path) {
+	for(const t_codec *codec = codecs; codec->extension != NULL; codec++) {
+		if(mstring_hassuffix(path, codec->extension)) return codec->program;
+	}
+	return NULL;
+}
+
+bool codec_check() {
+	bool ok = true;
+	for(const t_codec *codec = codecs; codec->extension != NULL; codec++) {
+		if(installed(codec->program)) continue;
+		log_report("No se encontró %s: los jobs que comprimen con %s fallarían en este nodo", codec->program, codec->extension);
+		ok = false;
+	}
+	return ok;
+}
+
+void codec_decompress(t_pipeline *pipeline, const char *input) {
+	const char *program = codec_program(input);
+	if(program != NULL) pipeline_add(pipeline, program, "-d", "-c", "-q");
+}
+
+void codec_compress(t_pipeline *pipeline, const char *output) {
+	const char *program = codec_program(output);
+	if(program != NULL) pipeline_add(pipeline, program, "-c", "-q");
+}
+
+bool codec_merge(mlist_t *sources, const char *target) {
+	uint64_t inicio = trace_now();
+	// Si el compresor se cae, escribirle no debe terminar el proceso: se bloquea
+	// SIGPIPE en este hilo y se descarta al final, como en pipeline_run
+	sigset_t sigpipe, oldmask;
+	sigemptyset(&sigpipe);
+	sigaddset(&sigpipe, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &sigpipe, &oldmask);
+
+	int count = mlist_length(sources);
+	t_stream inputs[count];
+	bool ok = true;
+	for(int i = 0; i < count; i++) {
+		inputs[i] = open_input(mlist_get(sources, i));
+		ok = ok && inputs[i].file != NULL;
+	}
+	t_stream output = open_output(target);
+	ok = ok && output.file != NULL;
+	if(ok) ok = merge(inputs, count, output.file);
+
+	for(int i = 0; i < count; i++) {
+		ok = close_stream(&inputs[i]) && ok;
+	}
+	ok = close_stream(&output) && ok;
+	if(!ok) log_report("No se pudo aparear en %s: falló el códec", target);
+
+	struct timespec zero = {0, 0};
+	while(sigtimedwait(&sigpipe, NULL, &zero) == SIGPIPE);
+	pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+	trace_span("merge", inicio, trace_now(), "%d archivos%s", count, codec_program(target) != NULL ? " (comprimido)" : "");
+	return ok;
+}
+
+// ========== Funciones privadas ==========
+
+static bool installed(const char *program) {
+	// Se busca igual que posix_spawnp: en cada directorio del PATH
+	const char *path = getenv("PATH");
+	if(path == NULL) return false;
+	char *dirs = mstring_duplicate(path);
+	bool found = false;
+	char *rest = dirs;
+	for(char *dir = strsep(&rest, ":"); dir != NULL && !found; dir = strsep(&rest, ":")) {
+		char *candidate = mstring_create("%s/%s", mstring_isempty(dir) ? "." : dir, program);
+		found = access(candidate, X_OK) == 0;
+		free(candidate);
+	}
+	free(dirs);
+	return found;
+}
+
+static t_stream open_input(const char *path) {
+	// Un archivo comprimido se lee de la salida de su descompresor, sin expandirlo en disco
+	t_stream stream = {NULL, -1};
+	const char *program = codec_program(path);
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	int fds[2];
+	if(fd == -1) return stream;
+	if(program == NULL) {
+		stream.file = fdopen(fd, "r");
+		return stream;
+	}
+	if(pipe2(fds, O_CLOEXEC) == -1) {
+		close(fd);
+		return stream;
+	}
+	stream.pid = pipeline_spawn(fd, fds[1], program, "-d", "-c", "-q");
+	close(fd);
+	close(fds[1]);
+	if(stream.pid == -1) close(fds[0]);
+	else stream.file = fdopen(fds[0], "r");
+	return stream;
+}
+
+static t_stream open_output(const char *path) {
+	// El resultado pasa directo al compresor, que es el único que escribe el destino
+	t_stream stream = {NULL, -1};
+	const char *program = codec_program(path);
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0664);
+	int fds[2];
+	if(fd == -1) return stream;
+	if(program == NULL) {
+		stream.file = fdopen(fd, "w");
+		return stream;
+	}
+	if(pipe2(fds, O_CLOEXEC) == -1) {
+		close(fd);
+		return stream;
+	}
+	stream.pid = pipeline_spawn(fds[0], fd, program, "-c", "-q");
+	close(fd);
+	close(fds[0]);
+	if(stream.pid == -1) close(fds[1]);
+	else stream.file = fdopen(fds[1], "w");
+	return stream;
+}
+
+static bool close_stream(t_stream *stream) {
+	// Se cierra antes de esperar: el compresor termina al ver el fin de su entrada
+	// y el descompresor, si no se leyó todo, al perder al lector
+	bool ok = stream->file != NULL;
+	if(stream->file != NULL) ok = fclose(stream->file) == 0;
+	if(stream->pid != -1) ok = pipeline_wait(stream->pid) && ok;
+	return ok;
+}
+
+static bool merge(t_stream *inputs, int count, FILE *output) {
+	// Apareo de k vías: se escribe siempre la menor de las líneas pendientes
+	char *lines[count];
+	size_t sizes[count];
+	bool read_line(int i) {
+		ssize_t length = getline(&lines[i], &sizes[i], inputs[i].file);
+		if(length == -1) return false;
+		if(length > 0 && lines[i][length - 1] == '\n') lines[i][length - 1] = '\0';
+		return true;
+	}
+	bool pending[count];
+	for(int i = 0; i < count; i++) {
+		lines[i] = NULL;
+		sizes[i] = 0;
+		pending[i] = read_line(i);
+	}
+
+	while(true) {
+		int min = -1;
+		for(int i = 0; i < count; i++) {
+			if(pending[i] && (min == -1 || !mstring_asc(lines[min], lines[i]))) min = i;
+		}
+		if(min == -1) break;
+		fputs(lines[min], output);
+		fputc('\n', output);
+		pending[min] = read_line(min);
+	}
+
+	bool ok = !ferror(output);
+	for(int i = 0; i < count; i++) {
+		ok = ok && !ferror(inputs[i].file);
+		free(lines[i]);
+	}
+	return ok;
+}
@@ -0,0 +1,53 @@
+#ifndef CODEC_H_
+#define CODEC_H_
+
+#include <stdbool.h>
+#include <mlist.h>
+#include <pipeline.h>
+
+/**
+ * Devuelve el compresor que corresponde a un archivo intermedio.
+ * YAMA elige el códec por job y lo indica con la extensión del nombre
+ * (.lz4 o .zst), así que los archivos se describen solos aunque viajen
+ * entre Workers.
+ * @param path Ruta o nombre del archivo.
+ * @return Programa compresor, o NULL si el archivo no va comprimido.
+ */
+const char *codec_program(const char *path);
+
+/**
+ * Verifica que los compresores estén instalados.
+ * Un nodo sin ellos haría fallar cada transformación de un job comprimido,
+ * así que el Worker lo revisa al arrancar.
+ * @return Valor lógico indicando si se encontraron todos los compresores.
+ */
+bool codec_check(void);
+
+/**
+ * Agrega al principio de la tubería la etapa que descomprime la entrada.
+ * No hace nada si el archivo no va comprimido.
+ * @param pipeline Tubería (sin etapas todavía).
+ * @param input Archivo que la tubería recibe como entrada.
+ */
+void codec_decompress(t_pipeline *pipeline, const char *input);
+
+/**
+ * Agrega al final de la tubería la etapa que comprime la salida.
+ * No hace nada si el archivo no va comprimido.
+ * @param pipeline Tubería.
+ * @param output Archivo donde escribe la tubería.
+ */
+void codec_compress(t_pipeline *pipeline, const char *output);
+
+/**
+ * Aparea archivos ordenados que pueden estar comprimidos.
+ * Los comprimidos se leen a través de su descompresor y el resultado pasa
+ * directo al compresor si el nombre del destino lo pide: nada se escribe
+ * expandido en disco.
+ * @param sources Lista con las rutas absolutas de los archivos a aparear.
+ * @param target Ruta absoluta del archivo a crear.
+ * @return Valor lógico indicando si se pudo descomprimir y comprimir todo.
+ */
+bool codec_merge(mlist_t *sources, const char *target);
+
+#endif /* CODEC_H_ */
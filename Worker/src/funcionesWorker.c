@@ -1,58 +1,22 @@
 #include "funcionesWorker.h"
 
-t_file* crearScript(char * bufferScript, int etapa,int nroSocket) {
-	int aux, auxChmod;
-	char mode[] = "0777";
-	t_file*script;
-	aux = string_length(bufferScript);
-	const char * nombreScript = path_temp();
-	if (etapa == OP_INICIAR_TRANSFORMACION){
-		script = file_create(nombreScript);
-		log_print("SCRIPT DE TRANSFORMACION: %s CREADO PARA SOCKET: %d",nombreScript,nroSocket);
-	}
-	else if (etapa == OP_INICIAR_REDUCCION_LOCAL){
-		script = file_create(nombreScript);
-		log_print("SCRIPT DE REDUCCION LOCAL: %s CREADO PARA SOCKET: %d",nombreScript,nroSocket);
-	}
-	else{
-		script = file_create(nombreScript);
-		log_print("SCRIPT DE REDUCCION Global: %s CREADO PARA SOCKET: %d",nombreScript,nroSocket);
-	}
-	//file_open(file_path(script));
-	fwrite(bufferScript, sizeof(char), aux, file_pointer(script));
-	auxChmod = strtol(mode, 0, 8);
-	if (chmod(file_path(script), auxChmod) < 0) {
-		log_report("NO SE PUDO DAR PERMISOS DE EJECUCION AL ARCHIVO");
-	}
-
-	fclose(file_pointer(script));
-	return script;
-
-}
-
-t_file * crearArchivo(char * bufferArchivo, int size, char*nombreArchivo) {
-	t_file * archivo = file_create(nombreArchivo);
-	file_open(file_path(archivo));
-	fwrite(bufferArchivo, sizeof(char), size, file_pointer(archivo));
-	fclose(file_pointer(archivo));
-	return archivo;
-}
-
 tEtapaReduccionLocalWorker * etapa_rl_unpack_bis(t_serial * serial) {
 	tEtapaReduccionLocalWorker * rl = malloc(
 			sizeof(tEtapaReduccionLocalWorker));
 	char * elemento;
 	rl->archivosTemporales = mlist_create();
-	serial_remove(serial, "s", &rl->script); //En realidad no es nodo, pero como nodo es (char*) aprovecho para almacenar el script
-	serial_remove(serial, "i", &rl->lenLista);
+	t_serial_reader reader = serial_reader(serial);
+	serial_read(&reader, "s", &rl->script); // Hash MD5 del script de reducción
+	serial_read(&reader, "i", &rl->lenLista);
 	for (int i = 0; i < rl->lenLista; i++) {
-		serial_remove(serial, "s", &elemento);
+		serial_read(&reader, "s", &elemento);
 		char * aux = mstring_create("%s%s", system_userdir(), elemento);
 		log_print("ARCHIVO RECIBIDO: %s",aux);
 		mlist_append(rl->archivosTemporales, aux);
 	}
 	log_print("CANTIDAD DE ARCHIVOS A REDUCIR: %d",mlist_length(rl->archivosTemporales));
-	serial_remove(serial, "s", &rl->archivoTemporal);
+	serial_read(&reader, "s", &rl->archivoTemporal);
+	serial_destroy(serial);
 	log_print("ARCHIVO TEMPORAL:%s",rl->archivoTemporal);
 	return rl;
 }
@@ -63,27 +27,31 @@ tEtapaReduccionGlobalWorker * rg_unpack(t_serial * serial) {
 			sizeof(tEtapaReduccionGlobalWorker));
 	rg_w->datosWorker = mlist_create();
 
-	serial_remove(serial, "s", &rg_w->scriptReduccion);
-	serial_remove(serial, "i", &rg_w->lenLista);
+	t_serial_reader reader = serial_reader(serial);
+	serial_read(&reader, "s", &rg_w->scriptReduccion);
+	serial_read(&reader, "i", &rg_w->lenLista);
 
 	for (int i = 0; i < rg_w->lenLista; i++) {
 		tEtapaReduccionGlobal *rg = malloc(sizeof(tEtapaReduccionGlobal));
-		serial_remove(serial, "sssss", &rg->nodo, &rg->ip, &rg->puerto,
+		serial_read(&reader, "sssss", &rg->nodo, &rg->ip, &rg->puerto,
 				&rg->archivo_temporal_de_rl, &rg->encargado);
 		printf("Archivo temporal_de_rl: %s\n",rg->archivo_temporal_de_rl);
 		mlist_append(rg_w->datosWorker, rg);
 	}
 
-	serial_remove(serial, "s", &rg_w->archivoEtapa);
+	serial_read(&reader, "s", &rg_w->archivoEtapa);
+	serial_destroy(serial);
 
 	return rg_w;
 }
 
 t_socket connect_to_worker(const char *ip, const char *port) { // La ip y el puerto son obtenidos mediante YAMA
-	t_socket socket = socket_connect(ip, port);
+	uint64_t inicio = trace_now();
+	t_socket socket = socket_connect_profile(ip, port, SOCKET_BULK);
+	trace_span("conexion", inicio, trace_now(), "Worker %s:%s%s", ip, port, socket == -1 ? " (falló)" : "");
 	if (socket == -1) {
 		log_report("Worker no está corriendo en %s:%s", ip, port);
-		exit(EXIT_FAILURE);
+		return -1;
 	}
 
 	protocol_send_handshake(socket);
@@ -92,29 +60,9 @@ t_socket connect_to_worker(const char *ip, const char *port) { // La ip y el pue
 	return socket;
 }
 
-void ejecutarComando(char * command, int socketAceptado) {
-	int status;
-	printf("COMANDO:%s\n", command);
-	system(command);
-	if ((status = system(command)) < 0) {
-		log_report(
-				"NO SE PUDO EJECTUAR EL COMANDO EN SYSTEM, FALLA REDUCCION LOCAL");
-		free(command);
-		protocol_send_response(socketAceptado, -1);
-		exit(1);
-	} else {
-		log_print("Se manda respuesta correcta a master");
-		protocol_send_response(socketAceptado, 1);
-	}
-}
-
 char * crearListaParaReducir(tEtapaReduccionGlobalWorker * rg) {
 	log_print("CREANDO RUTA");
 	mlist_t * archivosAReducir = mlist_create();
-	mlist_t * socketsAWorker = mlist_create();
-	int socket;
-	int size;
-	char * bufferArchivoTemporal;
 	char * archivoAReducir ;
 	if (rg->lenLista > 1) {
 		printf("tamanio lista:%d\n",rg->lenLista);
@@ -124,18 +72,39 @@ char * crearListaParaReducir(tEtapaReduccionGlobalWorker * rg) {
 			if (!string_equals_ignore_case(rg->rg->encargado, SI)) {
 				t_socket socketWorker = connect_to_worker(rg->rg->ip,
 						rg->rg->puerto);
-				socket = socketWorker;
-				mlist_append(socketsAWorker, &socket);
+				if (socketWorker == -1) {
+					mlist_destroy(archivosAReducir, free);
+					free(archivoAReducir);
+					return NULL;
+				}
+				uint64_t inicioTransferencia = trace_now();
 				t_packet paquete;
 				paquete.content = serial_pack("s",
 						rg->rg->archivo_temporal_de_rl);
 				paquete.operation = OP_MANDAR_ARCHIVO;
 				protocol_send_packet(paquete, socketWorker);
-				paquete = protocol_receive_packet(socketWorker);
-				serial_unpack(paquete.content, "si", &bufferArchivoTemporal, &size);
-				t_file * archivo = crearArchivo(bufferArchivoTemporal, size,
-						rg->rg->archivo_temporal_de_rl);
-				mlist_append(archivosAReducir, (char *)file_path(archivo));
+				serial_destroy(paquete.content);
+				// El archivo llega en flujo y se escribe a disco a medida que se recibe
+				uint64_t size;
+				paquete = protocol_receive_stream(socketWorker, &size);
+				serial_destroy(paquete.content);
+				t_file * archivo = paquete.operation == OP_MANDAR_ARCHIVO ?
+						file_create(rg->rg->archivo_temporal_de_rl) : NULL;
+				bool recibido = archivo != NULL && protocol_receive_file(socketWorker,
+						fileno(file_pointer(archivo)), size);
+				socket_close(socketWorker);
+				trace_span("transferencia", inicioTransferencia, trace_now(), "%s de %s: %llu bytes",
+						rg->rg->archivo_temporal_de_rl, rg->rg->nodo, (unsigned long long) size);
+				if (!recibido) {
+					log_report("No se recibió el archivo %s", rg->rg->archivo_temporal_de_rl);
+					if (archivo != NULL) file_close(archivo);
+					mlist_destroy(archivosAReducir, free);
+					free(archivoAReducir);
+					return NULL;
+				}
+				metrics_add(metrics_counter("worker_bytes_recibidos_total"), size);
+				mlist_append(archivosAReducir, mstring_duplicate(file_path(archivo)));
+				file_close(archivo);
 
 			}else{
 				//log_print("SOY ENCARGADO para generar el archivo: %s",rg->archivoEtapa);
@@ -143,266 +112,609 @@ char * crearListaParaReducir(tEtapaReduccionGlobalWorker * rg) {
 				mlist_append(archivosAReducir, aux);
 			}
 		}
-		path_merge(archivosAReducir, archivoAReducir);
+		if (!codec_merge(archivosAReducir, archivoAReducir)) {
+			path_remove(archivoAReducir);
+			mlist_destroy(archivosAReducir, free);
+			free(archivoAReducir);
+			return NULL;
+		}
 	}else{
 		log_print("ESTO SIGNIFICA QUE SOLO HAY 1 NODO LABURANDO");
 		rg->rg = mlist_get(rg->datosWorker,0);
 		archivoAReducir = mstring_create("%s%s",system_userdir(),rg->rg->archivo_temporal_de_rl);
 		log_print("Archivo a reducir: %s\n",archivoAReducir);
+		mlist_destroy(archivosAReducir, free);
 		return archivoAReducir;
 	}
 	printf("Archivo a reducir: %s\n",archivoAReducir);
-	free(bufferArchivoTemporal);
+	mlist_destroy(archivosAReducir, free);
 	return archivoAReducir;
 }
 
 tEtapaAlmacenamientoWorker * af_unpack(t_serial * serial) {
 	log_print("DESAMPAQUETANDO AF");
-	tEtapaAlmacenamientoWorker * af = malloc(sizeof af);
-	serial_remove(serial, "ss", &af->archivoReduccion, &af->archivoFinal);
+	tEtapaAlmacenamientoWorker * af = malloc(sizeof(tEtapaAlmacenamientoWorker));
+	serial_unpack(serial, "ss", &af->archivoReduccion, &af->archivoFinal);
 	log_print("Archivo de reduccion: %s , archivoFinal: %s \n",af->archivoReduccion,af->archivoFinal);
 	return af;
 }
 
-int connect_to_filesystem() {
-	t_socket socket = socket_connect(config_get("IP_FILESYSTEM"),
-			config_get("PUERTO_FILESYSTEM"));
+t_socket connect_to_filesystem() {
+	uint64_t inicio = trace_now();
+	t_socket socket = socket_connect_profile(config_get("IP_FILESYSTEM"),
+			config_get("PUERTO_FILESYSTEM"), SOCKET_BULK);
+	trace_span("conexion", inicio, trace_now(), "FileSystem%s", socket == -1 ? " (falló)" : "");
+	if (socket == -1) return -1;
 	protocol_send_handshake(socket);
 	int response = protocol_receive_response(socket);
 	if (response == RESPONSE_ERROR) {
 		log_print("Conexión rechazada. El FileSystem no se encuentra estable.");
 		socket_close(socket);
-	} else {
-		log_inform("Conectado a proceso FileSystem por socket %i", socket);
-		socketFileSystem = socket;
+		return -1;
 	}
-	return response;
+	log_inform("Conectado a proceso FileSystem por socket %i", socket);
+	return socket;
 }
 
-
 void listen_to_master() {
+	if (!codec_check()) system_exit("Faltan compresores para los archivos intermedios: correr install.sh");
 	log_print("Escuchando puertos");
+	scripts_init();
+	scheduler_init();
+	session_init();
+	pool_init(hilos_pool(), atender_master);
 	socketEscuchaMaster = socket_init(NULL, config_get("PUERTO_WORKER"));
-	t_socket socketAceptado;
 
 	while (true) {
-		pid_t pid;
-		socketAceptado = socket_accept(socketEscuchaMaster);
-		printf("Socket Aceptado:%d\n", socketAceptado);
-		if (protocol_receive_handshake(socketAceptado, PROC_MASTER)) {
-			log_print("HANDSHAKE CON PROC_MASTER");
-			if ((pid = fork()) == 0) {
-				log_print("PROCESO_HIJO:%d", pid);
-				t_packet packet = protocol_receive_packet(socketAceptado);
-				switch (packet.operation) {
-				case OP_INICIAR_TRANSFORMACION:
-					log_print("OP_INICIAR_TRANSFORMACION");
-					tEtapaTransformacionWorker * trans = malloc(sizeof(tEtapaTransformacionWorker));
-					char * bufferScript, *archivoEtapa;
-					t_file*scriptTransformacion;
-					serial_unpack(packet.content, "ssii", &bufferScript,
-							&archivoEtapa, &trans->bloque,
-							&trans->bytesOcupados);
-					scriptTransformacion = crearScript(bufferScript,
-							OP_INICIAR_TRANSFORMACION,socketAceptado);
-
-					bool tt_ok = block_transform(trans->bloque, trans->bytesOcupados, file_path(scriptTransformacion), archivoEtapa,trans->bytesOcupados);
-					if (tt_ok) {
-						log_print("MANDANDO RESPUESTA CORRECTA A MASTER");
-						protocol_send_response(socketAceptado,RESPONSE_OK );
-					} else {
-						log_report("MANDANDO RESPUESTA INCORRECTA A MASTER");
-						protocol_send_response(socketAceptado, RESPONSE_ERROR);
-					}
-					path_remove(file_path(scriptTransformacion));
-					//serial_destroy(packet.content); //agrego esto
-					free(bufferScript); //lo movi, originalmente estaba en linea 208
-					exit(1);
-					break;
-				case OP_INICIAR_REDUCCION_LOCAL:
-					log_print("OP_INICIAR_REDUCCION_LOCAL");
-					char* archivoPreReduccion = path_temp();
-					tEtapaReduccionLocalWorker* rl;
-					rl = etapa_rl_unpack_bis(packet.content);
-					t_file *scriptReduccion = crearScript(rl->script,
-							OP_INICIAR_REDUCCION_LOCAL,socketAceptado);
-					char * aux = mstring_create("%s/%s", system_userdir(),
-							archivoPreReduccion);
-					t_file * archivo = file_create(aux);
-					log_print("archivoPreReduccion: %s,aux:%s, archivo:%s\n",archivoPreReduccion,aux,file_path(archivo));
-					path_merge(rl->archivosTemporales, file_path(archivo));
-					bool lr_ok = reducir_path(file_path(archivo), file_path(scriptReduccion), rl->archivoTemporal);
-					if(lr_ok){
-						log_print("MANDANDO RESPUESTA CORRECTA A MASTER");
-					protocol_send_response(socketAceptado, lr_ok ? RESPONSE_OK : RESPONSE_ERROR);
-					}else{
-						log_report("MANDANDO RESPUESTA INCORRECTA A MASTER");
-											protocol_send_response(socketAceptado, lr_ok ? RESPONSE_OK : RESPONSE_ERROR);
-					}
-					path_remove(file_path(scriptReduccion));
-					path_remove(archivoPreReduccion);
-					exit(1);
-					break;
-				case OP_INICIAR_REDUCCION_GLOBAL:
-					log_print("OP_INICIAR_REDUCCION_GLOBAL");
-					char *archivoAReducir;
-					tEtapaReduccionGlobalWorker * rg;
-					rg = rg_unpack(packet.content);
-					t_file *scriptReduccionGlobal;
-					scriptReduccionGlobal = crearScript(rg->scriptReduccion,
-							OP_INICIAR_REDUCCION_GLOBAL,socketAceptado);
-					archivoAReducir = crearListaParaReducir(rg);
-					bool gr_ok = reducir_path(archivoAReducir, file_path(scriptReduccionGlobal), rg->archivoEtapa);
-					protocol_send_response(socketAceptado, gr_ok ? RESPONSE_OK : RESPONSE_ERROR);
-					path_remove(file_path(scriptReduccionGlobal));
-					path_remove(archivoAReducir);
-					exit(1);
-					break;
-				case OP_INICIAR_ALMACENAMIENTO:
-					log_print("OP_INICIAR_ALMACENAMIENTO");
-					tEtapaAlmacenamientoWorker * af;
-					af = af_unpack(packet.content);
-					t_file * archivoReduccion;
-					char * bufferArchivoReduccion;
-					char * aux2 = mstring_create("%s%s",system_userdir(),af->archivoReduccion);
-					printf("Archivo reduccion:%s\n",aux2);
-					archivoReduccion = file_open(aux2);
-					bufferArchivoReduccion = file_map(archivoReduccion);
-					t_serial *serialFileSystem = serial_pack("ssi", bufferArchivoReduccion, af->archivoFinal, file_size(archivoReduccion));
-					printf("file_size: %d\n", file_size(archivoReduccion));
-					t_packet paquete = protocol_packet(
-							OP_INICIAR_ALMACENAMIENTO, serialFileSystem);
-					int response = connect_to_filesystem();
-					if (response < 0) {
-						log_report("No se pudo conectar al filesystem");
-						protocol_send_response(socketAceptado, -1);
-					} else {
-						protocol_send_packet(paquete, socketFileSystem);
-						int estado = protocol_receive_response(
-								socketFileSystem);
-						if (estado == RESPONSE_OK) {
-							log_print("Se informa a Master el termino del job");
-							protocol_send_response(socketAceptado, RESPONSE_OK);
-						} else {
-							log_print("Se informa a Master la falla del job");
-							protocol_send_response(socketAceptado, -2);
-						}
-					}
-					exit(1);
-					break;
-				default:
-					break;
-				}
-			} else if (pid > 0) {
-				log_print("PROCESO_PADRE:%d", pid);
-			} else if (pid < 0) {
-				log_report("NO SE PUDO HACER EL FORK");
-			}
+		bool nueva;
+		t_socket socketAceptado = session_wait(socketEscuchaMaster, &nueva);
+		if (socketAceptado == -1) continue;
+		if (!nueva) {
+			// Pedido en una sesión que Master mantiene abierta entre tareas
+			pool_submit(socketAceptado);
+			continue;
+		}
+		t_process remitente = protocol_receive_handshake(socketAceptado);
+		if (remitente != PROC_MASTER && remitente != PROC_WORKER) {
+			log_report("Se rechaza conexión en el socket %d: apretón de manos inválido", socketAceptado);
+			socket_close(socketAceptado);
+		} else if (remitente == PROC_MASTER) {
+			log_print("HANDSHAKE CON PROC_MASTER (socket %d)", socketAceptado);
+			pool_submit(socketAceptado);
+		} else {
+			// Los pedidos entre Workers no ocupan hilos del pool: el encargado de
+			// una reducción global los espera mientras ocupa uno.
+			log_print("Handshake de Worker Homologo (socket %d)", socketAceptado);
+			socket_set_profile(socketAceptado, SOCKET_BULK);
+			thread_create(atender_worker, (void*) (intptr_t) socketAceptado);
+		}
+	}
+}
 
+void atender_master(t_socket socket) {
+	t_packet packet = protocol_receive_packet(socket);
+	uint64_t inicio = metrics_now();
+	uint64_t inicioTraza = trace_now();
+	const char * etapa = NULL;
+	// La tarea y lo que se pida a otros procesos por ella van a la traza del job de Master
+	trace_set(packet.trace);
+	switch (packet.operation) {
+	case OP_INICIAR_TRANSFORMACION_LOTE:
+		log_print("OP_INICIAR_TRANSFORMACION_LOTE");
+		etapa_transformacion_lote(socket, packet.content);
+		etapa = "transformacion";
+		break;
+	case OP_INICIAR_REDUCCION_LOCAL:
+		log_print("OP_INICIAR_REDUCCION_LOCAL");
+		etapa_reduccion_local(socket, packet.content);
+		etapa = "reduccion_local";
+		break;
+	case OP_APAREO_PARCIAL:
+		log_print("OP_APAREO_PARCIAL");
+		etapa_apareo_parcial(socket, packet.content);
+		etapa = "apareo";
+		break;
+	case OP_INICIAR_REDUCCION_GLOBAL:
+		log_print("OP_INICIAR_REDUCCION_GLOBAL");
+		etapa_reduccion_global(socket, packet.content);
+		etapa = "reduccion_global";
+		break;
+	case OP_INICIAR_ALMACENAMIENTO:
+		log_print("OP_INICIAR_ALMACENAMIENTO");
+		etapa_almacenamiento(socket, packet.content);
+		etapa = "almacenamiento";
+		break;
+	case OP_UNDEFINED:
+		// Master cerró la sesión
+		socket_close(socket);
+		return;
+	default:
+		serial_destroy(packet.content);
+		break;
+	}
+	if (etapa != NULL) {
+		metrics_since(metrics_histogram("worker_tarea_us{etapa=\"%s\"}", etapa), inicio);
+		trace_span(etapa, inicioTraza, trace_now(), "socket %d", socket);
+	}
+	trace_set(0);
+	// La conexión queda abierta para la próxima tarea de Master
+	session_release(socket);
+}
+
+void atender_worker(void *arg) {
+	t_socket socket = (intptr_t) arg;
+	pthread_detach(pthread_self());
+	t_packet paquete = protocol_receive_packet(socket);
+	char * nombreDelArchivo;
+	trace_set(paquete.trace);
+	uint64_t inicio = trace_now();
+	switch (paquete.operation) {
+	case (OP_MANDAR_ARCHIVO):
+		serial_unpack(paquete.content, "s", &nombreDelArchivo);
+		char * aux = mstring_create("%s%s",system_userdir(),nombreDelArchivo);
+		//log_print("NOMBRE DEL ARCHIVO A MANDAR A ENCARGADO: %s",nombreDelArchivo);
+		// Se manda en flujo: el archivo puede ser binario y de cualquier tamaño
+		t_file * archivo = abrir_temporal(aux);
+		if (archivo == NULL) {
+			// El encargado recibe una respuesta en lugar del flujo y aborta la reducción
+			protocol_send_response(socket, -1);
 		} else {
-			log_print("Handshake de Worker Homologo");
-			if ((pid = fork()) == 0) {
-				log_print("Proceso hijo de worker homologo de pid: #%d", pid);
-				t_packet paquete = protocol_receive_packet(socketAceptado);
-				t_file * archivo;
-				char * nombreDelArchivo;
-				char *bufferArchivo;
-				switch (paquete.operation) {
-				case (OP_MANDAR_ARCHIVO): //OP_MANDAR_ARCHIVO
-					serial_unpack(paquete.content, "s", &nombreDelArchivo);
-					char * aux2 = mstring_create("%s%s",system_userdir(),nombreDelArchivo);
-					//log_print("NOMBRE DEL ARCHIVO A MANDAR A ENCARGADO: %s",nombreDelArchivo);
-					archivo = file_open(aux2);
-					bufferArchivo = file_map(archivo);
-					paquete.content = serial_pack("si", bufferArchivo, file_size(archivo));
-					paquete.operation = OP_MANDAR_ARCHIVO;
-					protocol_send_packet(paquete, socketAceptado);
-					file_unmap(archivo, bufferArchivo);
-					exit(1);
-					break;
-				default:
-					log_report("OP_UNDIFINED");
-					exit(1);
-					break;
-				}
-			} else if (pid > 0) {
-				log_print("PROCESO PADRE HOMOLOG");
-			} else if (pid < 0) {
-				log_report("NO SE PUDO CREAR EL PROCESO HIJO HOMOLOGO");
+			protocol_send_stream(socket, OP_MANDAR_ARCHIVO, NULL, fileno(file_pointer(archivo)), file_size(archivo));
+			metrics_add(metrics_counter("worker_bytes_enviados_total"), file_size(archivo));
+			trace_span("envio_archivo", inicio, trace_now(), "%s: %zu bytes", nombreDelArchivo, file_size(archivo));
+			file_close(archivo);
+		}
+		free(nombreDelArchivo);
+		free(aux);
+		break;
+	default:
+		log_report("OP_UNDIFINED");
+		serial_destroy(paquete.content);
+		break;
+	}
+	socket_close(socket);
+}
+
+void etapa_transformacion_lote(t_socket socket, t_serial * content) {
+	tLoteTransformacion lote;
+	char * md5Script;
+	char * md5Combinador;
+	t_serial_reader reader = serial_reader(content);
+	int cantidad;
+	serial_read(&reader, "ssii", &md5Script, &md5Combinador, &lote.job, &cantidad);
+	lote.tareas = NULL;
+	lote.cantidad = 0;
+	leer_tareas(&lote, &reader, cantidad);
+	serial_destroy(content);
+
+	lote.script = obtener_script(socket, md5Script);
+	// Sin md5 el job no usa combinador: la salida se escribe solo ordenada
+	lote.combinador = mstring_isempty(md5Combinador) ? NULL : obtener_script(socket, md5Combinador);
+	if (lote.script == NULL || (!mstring_isempty(md5Combinador) && lote.combinador == NULL)) {
+		log_report("MANDANDO RESPUESTA INCORRECTA A MASTER");
+		protocol_send_response(socket, RESPONSE_ERROR);
+	} else {
+		// Desde acá Master puede mandar cancelaciones por el mismo socket
+		protocol_send_response(socket, RESPONSE_OK);
+		lote.socket = socket;
+		lote.siguiente = 0;
+		lote.error = false;
+		lote.mutex = thread_mutex_create();
+		lote.terminados = thread_sem_create(0);
+
+		int hilos = hilos_lote(lote.cantidad);
+		lote.activos = hilos;
+		log_print("Transformando %d bloques con %d hilos", lote.cantidad, hilos);
+		for (int i = 0; i < hilos; i++) {
+			thread_create(ejecutar_lote, &lote);
+		}
+		esperar_lote(&lote, hilos);
+		thread_mutex_destroy(lote.mutex);
+		thread_sem_destroy(lote.terminados);
+	}
+
+	for (int i = 0; i < lote.cantidad; i++) {
+		free(lote.tareas[i]->archivoEtapa);
+		free(lote.tareas[i]);
+	}
+	free(lote.tareas);
+	free(lote.script);
+	free(lote.combinador);
+	free(md5Script);
+	free(md5Combinador);
+}
+
+void ejecutar_lote(tLoteTransformacion * lote) {
+	pthread_detach(pthread_self());
+	trace_set(lote->job);
+	while (true) {
+		thread_mutex_lock(lote->mutex);
+		tEtapaTransformacionWorker * trans = NULL;
+		if (!lote->error && lote->siguiente < lote->cantidad) {
+			trans = lote->tareas[lote->siguiente++];
+		} else {
+			// Si Master amplía el lote después, esperar_lote crea los hilos que falten
+			lote->activos--;
+		}
+		thread_mutex_unlock(lote->mutex);
+		if (trans == NULL) break;
+
+		// La tubería se registra antes de esperar lugar: una cancelación que llega
+		// mientras tanto hace que no arranque ninguna etapa
+		t_pipeline * pipeline = pipeline_create();
+		thread_mutex_lock(lote->mutex);
+		bool cancelado = trans->cancelado;
+		trans->pipeline = pipeline;
+		thread_mutex_unlock(lote->mutex);
+
+		bool tt_ok = false;
+		int duracion = 0;
+		if (!cancelado) {
+			scheduler_acquire(lote->job);
+			mtime_t inicio = mtime_now();
+			tt_ok = block_transform(pipeline, trans->bloque, trans->bytesOcupados,
+					lote->script, lote->combinador, trans->archivoEtapa);
+			duracion = mtime_diff(mtime_now(), inicio);
+			metrics_record(metrics_histogram("worker_bloque_transformacion_us"), (uint64_t) duracion * 1000);
+			scheduler_release();
+		}
+
+		// Cada bloque se informa apenas termina, sin esperar al resto del lote
+		thread_mutex_lock(lote->mutex);
+		trans->pipeline = NULL;
+		trans->terminado = true;
+		// Otro nodo ya lo transformó: se avisa para que Master no lo espere y YAMA no lo
+		// tome como una falla del nodo
+		cancelado = !tt_ok && trans->cancelado;
+		if (cancelado) log_print("Bloque %d cancelado", trans->bloque);
+		else if (!tt_ok) log_report("FALLO LA TRANSFORMACION DEL BLOQUE %d", trans->bloque);
+		if (!tt_ok && !cancelado) lote->error = true;
+		t_serial * serial = serial_pack("iiii", trans->bloque,
+				tt_ok ? RESPONSE_OK : cancelado ? RESPONSE_CANCELADO : RESPONSE_ERROR,
+				scheduler_pending(), duracion);
+		protocol_send_packet(protocol_packet(OP_BLOQUE_TRANSFORMADO, serial),
+				lote->socket);
+		serial_destroy(serial);
+		thread_mutex_unlock(lote->mutex);
+		pipeline_destroy(pipeline);
+	}
+	thread_sem_signal(lote->terminados);
+}
+
+void esperar_lote(tLoteTransformacion * lote, int hilos) {
+	// Mientras los hilos transforman se atienden las cancelaciones y ampliaciones que
+	// manda Master, hasta que avisa que no hay más bloques para el lote
+	bool escuchando = true;
+	int terminados = 0;
+	while (escuchando || terminados < hilos) {
+		struct pollfd fd = { lote->socket, POLLIN, 0 };
+		if (!escuchando) {
+			thread_sem_wait(lote->terminados);
+			terminados++;
+			continue;
+		}
+		if (poll(&fd, 1, 100) > 0) {
+			t_packet packet = protocol_receive_packet(lote->socket);
+			if (packet.operation == OP_CANCELAR_TRANSFORMACION) {
+				int bloque;
+				serial_unpack(packet.content, "i", &bloque);
+				cancelar_bloque(lote, bloque);
+			} else if (packet.operation == OP_AMPLIAR_LOTE) {
+				hilos += ampliar_lote(lote, packet.content);
+			} else if (packet.operation == OP_FIN_LOTE) {
+				serial_destroy(packet.content);
+				escuchando = false;
+			} else {
+				// Master se desconectó: no tiene sentido seguir con el lote
+				serial_destroy(packet.content);
+				thread_mutex_lock(lote->mutex);
+				lote->error = true;
+				thread_mutex_unlock(lote->mutex);
+				escuchando = false;
 			}
 		}
+		while (sem_trywait(lote->terminados) == 0) terminados++;
 	}
 }
 
-bool block_transform(int blockno, size_t size, const char *script, const char *output,int bytesOcupados) {
-	char *scrpath = path_create(PTYPE_USER, script);
-	if(!path_exists(scrpath)) {
-		free(scrpath);
-		return false;
+void leer_tareas(tLoteTransformacion * lote, t_serial_reader * reader, int cantidad) {
+	lote->tareas = realloc(lote->tareas, (lote->cantidad + cantidad) * sizeof(tEtapaTransformacionWorker *));
+	for (int i = 0; i < cantidad; i++) {
+		tEtapaTransformacionWorker * trans = malloc(sizeof(tEtapaTransformacionWorker));
+		serial_read(reader, "sii", &trans->archivoEtapa, &trans->bloque,
+				&trans->bytesOcupados);
+		trans->cancelado = false;
+		trans->terminado = false;
+		trans->pipeline = NULL;
+		lote->tareas[lote->cantidad++] = trans;
 	}
-//
-//	size_t start = blockno * BLOCK_SIZE + 1;
-	char *datapath = path_create(PTYPE_YATPOS, config_get("RUTA_DATABIN"));
-	char *outpath = path_create(PTYPE_YATPOS, output);
-	//char *command = mstring_create("cat %s | tail -c %zi | head -c %zi | %s | sort > %s", datapath, start, size, scrpath, outpath);
-	char * command; int offset;
-	//log_print("Transformo en el BLOQUE: %d, la cantidad de: %d bytes\n",bytesOcupados,blockno);
-	if (blockno == 0) {
-		offset = bytesOcupados;
-		command = mstring_create("head -c %d < %s | %s | sort > %s%s",
-				offset, datapath, scrpath, system_userdir(), outpath);
+}
+
+int ampliar_lote(tLoteTransformacion * lote, t_serial * content) {
+	int cantidad;
+	t_serial_reader reader = serial_reader(content);
+	serial_read(&reader, "i", &cantidad);
+	thread_mutex_lock(lote->mutex);
+	leer_tareas(lote, &reader, cantidad);
+	// Solo se suman hilos si los que siguen activos no alcanzan para lo pendiente
+	int nuevos = hilos_lote(lote->cantidad - lote->siguiente) - lote->activos;
+	if (nuevos < 0) nuevos = 0;
+	lote->activos += nuevos;
+	thread_mutex_unlock(lote->mutex);
+	serial_destroy(content);
+
+	log_print("Lote ampliado con %d bloques y %d hilos más", cantidad, nuevos);
+	for (int i = 0; i < nuevos; i++) {
+		thread_create(ejecutar_lote, lote);
+	}
+	return nuevos;
+}
+
+void cancelar_bloque(tLoteTransformacion * lote, int bloque) {
+	// Si el bloque ya corre se terminan sus procesos: el hilo libera el lugar y lo informa cancelado
+	thread_mutex_lock(lote->mutex);
+	bool pendiente = false;
+	for (int i = 0; i < lote->cantidad; i++) {
+		tEtapaTransformacionWorker * trans = lote->tareas[i];
+		if (trans->bloque != bloque || trans->terminado) continue;
+		trans->cancelado = true;
+		if (trans->pipeline != NULL) pipeline_cancel(trans->pipeline);
+		pendiente = true;
+	}
+	thread_mutex_unlock(lote->mutex);
+	if (pendiente) log_print("Cancelación del bloque %d", bloque);
+	else log_print("Cancelación del bloque %d ignorada: ya terminó", bloque);
+}
+
+void etapa_reduccion_local(t_socket socket, t_serial * content) {
+	tEtapaReduccionLocalWorker* rl = etapa_rl_unpack_bis(content);
+	char * script = obtener_script(socket, rl->script);
+	char* archivoPreReduccion = path_temp();
+	char * aux = mstring_create("%s/%s", system_userdir(), archivoPreReduccion);
+	t_file * archivo = file_create(aux);
+	log_print("archivoPreReduccion: %s,aux:%s, archivo:%s\n",archivoPreReduccion,aux,file_path(archivo));
+	bool merge_ok = codec_merge(rl->archivosTemporales, file_path(archivo));
+	// Las reducciones cierran jobs ya avanzados, así que van antes que cualquier transformación
+	scheduler_acquire(0);
+	bool lr_ok = script != NULL && merge_ok && reducir_path(file_path(archivo), script, rl->archivoTemporal);
+	scheduler_release();
+	if(lr_ok){
+		log_print("MANDANDO RESPUESTA CORRECTA A MASTER");
+	}else{
+		log_report("MANDANDO RESPUESTA INCORRECTA A MASTER");
+	}
+	protocol_send_response(socket, lr_ok ? RESPONSE_OK : RESPONSE_ERROR);
+	file_close(archivo);
+	path_remove(archivoPreReduccion);
+	free(archivoPreReduccion);
+	free(aux);
+	free(script);
+	free(rl->script);
+	free(rl->archivoTemporal);
+	mlist_destroy(rl->archivosTemporales, free);
+	free(rl);
+}
+
+void etapa_apareo_parcial(t_socket socket, t_serial * content) {
+	int cantidad;
+	char * archivo;
+	mlist_t * archivos = mlist_create();
+	t_serial_reader reader = serial_reader(content);
+	serial_read(&reader, "i", &cantidad);
+	for (int i = 0; i < cantidad; i++) {
+		serial_read(&reader, "s", &archivo);
+		mlist_append(archivos, mstring_create("%s%s", system_userdir(), archivo));
+		free(archivo);
+	}
+	serial_read(&reader, "s", &archivo);
+	serial_destroy(content);
+	char * salida = mstring_create("%s%s", system_userdir(), archivo);
+
+	// Las salidas de transformación ya vienen ordenadas: se aparean en una sola corrida
+	// para que la reducción local final tenga pocos archivos que juntar
+	bool existen(char * path) {
+		return path_exists(path);
+	}
+	bool ok = mlist_all(archivos, existen);
+	if (ok) {
+		scheduler_acquire(0);
+		ok = codec_merge(archivos, salida);
+		scheduler_release();
+	}
+	if (ok) {
+		mlist_traverse(archivos, path_remove);
+		log_print("Apareo parcial de %d archivos en %s", cantidad, archivo);
 	} else {
-		offset = blockno * BLOCK_SIZE + bytesOcupados;
-		command = mstring_create(
-				"head -c %d < %s | tail -c %d | %s | sort > %s%s", offset,
-				datapath, bytesOcupados, scrpath, system_userdir(), outpath);
+		log_report("No se pudo completar el apareo parcial %s", archivo);
 	}
-	log_print("COMMAND: %s",command);
+	protocol_send_response(socket, ok ? RESPONSE_OK : RESPONSE_ERROR);
 
+	mlist_destroy(archivos, free);
+	free(salida);
+	free(archivo);
+}
 
-	int r = system(command);
-	if (r < 0) {
-		log_report("FALLO AL FORKEAR EN SYSTEM");
+void etapa_reduccion_global(t_socket socket, t_serial * content) {
+	tEtapaReduccionGlobalWorker * rg = rg_unpack(content);
+	char * script = obtener_script(socket, rg->scriptReduccion);
+	char * archivoAReducir = crearListaParaReducir(rg);
+	scheduler_acquire(0);
+	bool gr_ok = script != NULL && archivoAReducir != NULL && reducir_path(archivoAReducir, script, rg->archivoEtapa);
+	scheduler_release();
+	protocol_send_response(socket, gr_ok ? RESPONSE_OK : RESPONSE_ERROR);
+	if (archivoAReducir != NULL && rg->lenLista > 1) path_remove(archivoAReducir);
+	free(archivoAReducir);
+	free(script);
+	void destruir(tEtapaReduccionGlobal * elem) {
+		free(elem->nodo);
+		free(elem->ip);
+		free(elem->puerto);
+		free(elem->archivo_temporal_de_rl);
+		free(elem->encargado);
+		free(elem);
+	}
+	mlist_destroy(rg->datosWorker, destruir);
+	free(rg->scriptReduccion);
+	free(rg->archivoEtapa);
+	free(rg);
+}
 
-		//break;
-	} else if (r == 127) {
-		log_print("NO SE PUDO EJECTUAR EL COMMANDO");
+void etapa_almacenamiento(t_socket socket, t_serial * content) {
+	tEtapaAlmacenamientoWorker * af = af_unpack(content);
+	char * aux = mstring_create("%s%s",system_userdir(),af->archivoReduccion);
+	printf("Archivo reduccion:%s\n",aux);
+	t_file * archivoReduccion = abrir_temporal(aux);
+	t_socket socketFileSystem = archivoReduccion == NULL ? -1 : connect_to_filesystem();
+	if (archivoReduccion == NULL) {
+		protocol_send_response(socket, -1);
+	} else if (socketFileSystem == -1) {
+		log_report("No se pudo conectar al filesystem");
+		protocol_send_response(socket, -1);
+	} else {
+		// El destino va en los metadatos y el archivo en flujo, sin cargarlo en memoria
+		uint64_t inicio = trace_now();
+		t_serial *destino = serial_pack("s", af->archivoFinal);
+		protocol_send_stream(socketFileSystem, OP_INICIAR_ALMACENAMIENTO, destino,
+				fileno(file_pointer(archivoReduccion)), file_size(archivoReduccion));
+		serial_destroy(destino);
+		int estado = protocol_receive_response(socketFileSystem);
+		socket_close(socketFileSystem);
+		trace_span("envio_almacenamiento", inicio, trace_now(), "%s (estado %d)", af->archivoFinal, estado);
+		if (estado == RESPONSE_OK) {
+			log_print("Se informa a Master el termino del job");
+			protocol_send_response(socket, RESPONSE_OK);
+		} else {
+			log_print("Se informa a Master la falla del job");
+			protocol_send_response(socket, -2);
+		}
+	}
+	if (archivoReduccion != NULL) file_close(archivoReduccion);
+	free(aux);
+	free(af->archivoReduccion);
+	free(af->archivoFinal);
+	free(af);
+}
 
-		//break;
+t_file * abrir_temporal(const char * path) {
+	// file_open crea el archivo si falta y termina el proceso si no lo puede abrir
+	if (access(path, R_OK | W_OK) == -1) {
+		log_report("No se puede abrir el archivo temporal %s: %s", path, strerror(errno));
+		return NULL;
 	}
-	free(command);
+	return file_open(path);
+}
+
+char * obtener_script(t_socket socket, const char * md5) {
+	char * script = scripts_find(md5);
+	if (script != NULL) return script;
+	uint64_t inicio = trace_now();
+
+	log_print("Script %s no disponible, se solicita a Master", md5);
+	t_serial * serial = serial_pack("s", md5);
+	protocol_send_packet(protocol_packet(OP_SCRIPT_REQUEST, serial), socket);
+	serial_destroy(serial);
+
+	t_packet packet = protocol_receive_packet(socket);
+	if (packet.operation != OP_SCRIPT) {
+		log_report("No se recibió el script %s", md5);
+		serial_destroy(packet.content);
+		return NULL;
+	}
+	char * contenido;
+	serial_unpack(packet.content, "s", &contenido);
+	script = scripts_add(md5, contenido, strlen(contenido));
+	trace_span("script", inicio, trace_now(), "%s: %zu bytes", md5, strlen(contenido));
+	free(contenido);
+	return script;
+}
+
+int hilos_lote(int cantidad) {
+	int hilos = scheduler_limit();
+	return cantidad < hilos ? cantidad : hilos;
+}
+
+int hilos_pool() {
+	const char * hilos = config_get("HILOS_WORKER");
+	int cantidad = hilos == NULL ? 0 : mstring_toint(hilos);
+	return cantidad > 0 ? cantidad : sysconf(_SC_NPROCESSORS_ONLN) * 2;
+}
+
+bool block_transform(t_pipeline *pipeline, int blockno, size_t size, const char *script, const char *combiner, const char *output) {
+	if(!path_exists(script)) return false;
+	if(combiner != NULL && !path_exists(combiner)) return false;
+
+	char *datapath = path_create(PTYPE_YATPOS, config_get("RUTA_DATABIN"));
+	char *outpath = path_create(PTYPE_YATPOS, output);
+	char *destino = mstring_create("%s%s", system_userdir(), outpath);
+
+	// Equivale a head -c | tail -c | script | sort, sin shell ni procesos para recortar el bloque
+	pipeline_input(pipeline, datapath, (off_t) blockno * BLOCK_SIZE, size);
+	pipeline_add(pipeline, script);
+	pipeline_add(pipeline, "sort");
+	// El reductor recibe la salida ordenada y la deja ordenada, así que el apareo no cambia
+	if(combiner != NULL) pipeline_add(pipeline, combiner);
+	codec_compress(pipeline, destino);
+	pipeline_output(pipeline, destino);
+	uint64_t inicio = trace_now();
+	bool ok = pipeline_run(pipeline);
+	log_pipeline(pipeline, "TRANSFORMACION", ok);
+	trace_span("transformacion", inicio, trace_now(), "bloque %d: %zu bytes%s", blockno, size,
+			ok ? "" : pipeline_cancelled(pipeline) ? " (cancelado)" : " (falló)");
+	trace_pipeline(pipeline, "TRANSFORMACION", inicio);
+
+	free(destino);
 	free(datapath);
-	free(scrpath);
 	free(outpath);
-	printf("EL RESULTADO DE SYSTEM %d \n", r);
-	return r ==0;
+	return ok;
 }
+
 bool reducir_path(const char *input, const char *script, const char *output) {
-	char *scrpath = path_create(PTYPE_USER, script);
-	if(!path_exists(scrpath)) {
-		free(scrpath);
-		return false;
-	}
+	if(!path_exists(script)) return false;
 
 	char *inpath = path_create(PTYPE_YATPOS, input);
 	char *outpath = path_create(PTYPE_YATPOS, output);
+	char *destino = mstring_create("%s%s", system_userdir(), outpath);
 
-	char *command = mstring_create("cat %s | %s > %s%s", inpath, scrpath, system_userdir(),outpath);
-
-	int r = system(command);
-	if(r<0){
-		log_report("FALLO AL FORKEAR EN SYSTEM");
-		free(command);
-				//break;
-	}else if(r == 127){
-		log_print("NO SE PUDO EJECTUAR EL COMMANDO");
-		free(command);
-				//break;
-	}
-	log_print("COMMAND: %s",command);
+	t_pipeline *pipeline = pipeline_create();
+	pipeline_input(pipeline, inpath, 0, -1);
+	codec_decompress(pipeline, inpath);
+	pipeline_add(pipeline, script);
+	codec_compress(pipeline, destino);
+	pipeline_output(pipeline, destino);
+	uint64_t inicio = trace_now();
+	bool ok = pipeline_run(pipeline);
+	log_pipeline(pipeline, "REDUCCION", ok);
+	trace_span("reduccion", inicio, trace_now(), "%s%s", path_name(input), ok ? "" : " (falló)");
+	trace_pipeline(pipeline, "REDUCCION", inicio);
+
+	pipeline_destroy(pipeline);
+	free(destino);
 	free(inpath);
 	free(outpath);
-	free(command);
-	free(scrpath);
-	return r == 0 ;
+	return ok;
+}
+
+void log_pipeline(t_pipeline *pipeline, const char *tarea, bool ok) {
+	int etapas = pipeline_length(pipeline);
+	if (etapas > 0) {
+		// Lo que entra a la primera etapa y sale de la última, sin contar lo que pasa entre etapas
+		metrics_add(metrics_counter("worker_bytes_leidos_total{tarea=\"%s\"}", tarea), pipeline_stats(pipeline, 0).bytes_in);
+		metrics_add(metrics_counter("worker_bytes_escritos_total{tarea=\"%s\"}", tarea), pipeline_stats(pipeline, etapas - 1).bytes_out);
+	}
+	for (int i = 0; i < etapas; i++) {
+		t_pstats stats = pipeline_stats(pipeline, i);
+		const char *formato = "%s etapa %d (%s): código %d, CPU %.3fs, %zu bytes leídos, %zu escritos";
+		if (ok) log_print(formato, tarea, i, pipeline_program(pipeline, i), stats.status, stats.cpu, stats.bytes_in, stats.bytes_out);
+		else log_report(formato, tarea, i, pipeline_program(pipeline, i), stats.status, stats.cpu, stats.bytes_in, stats.bytes_out);
+	}
+}
+
+void trace_pipeline(t_pipeline *pipeline, const char *tarea, uint64_t inicio) {
+	// Las etapas corren a la vez desde el mismo inicio: cada tramo termina cuando la etapa
+	// terminó de escribir, así que la que más se extiende (sort suele ser) es la que retiene al resto
+	for (int i = 0; i < pipeline_length(pipeline); i++) {
+		t_pstats stats = pipeline_stats(pipeline, i);
+		trace_span(path_name(pipeline_program(pipeline, i)), inicio, inicio + (uint64_t) (stats.elapsed * 1000000),
+				"%s etapa %d: CPU %.3fs, %zu bytes leídos, %zu escritos", tarea, i, stats.cpu, stats.bytes_in, stats.bytes_out);
+	}
 }
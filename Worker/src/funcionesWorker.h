@@ -1,6 +1,7 @@
 #ifndef FUNCIONESWORKER_H
 #define FUNCIONESWORKER_H
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -9,8 +10,10 @@
 #include <string.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
 #include <string.h>
 #include <pthread.h>
+#include <stdint.h>
 
 #include <sys/select.h>
 #include <sys/types.h>
@@ -20,16 +23,21 @@
 #include <config.h>
 #include <data.h>
 #include <file.h>
+#include <layout.h>
 #include <log.h>
+#include <metrics.h>
 #include <mstring.h>
+#include <mtime.h>
 #include <path.h>
+#include <pipeline.h>
 #include <process.h>
 #include <protocol.h>
 #include <serial.h>
 #include <socket.h>
 #include <struct.h>
 #include <system.h>
-#include <data.h>
+#include <thread.h>
+#include <trace.h>
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -39,6 +47,12 @@
 #include <commons/log.h>
 #include <commons/string.h>
 
+#include "codec.h"
+#include "pool.h"
+#include "scheduler.h"
+#include "scripts.h"
+#include "session.h"
+
 #define MAX_IP_LEN 16   // aaa.bbb.ccc.ddd -> son 15 caracteres, 16 contando un '\0'
 #define MAX_PORT_LEN 6  // 65535 -> 5 digitos, 6 contando un '\0'
 #define MAX_NOMBRE_NODO 5
@@ -55,10 +69,28 @@
 
 
 typedef struct{
+		char * archivoEtapa;
 		int bloque;
 		int bytesOcupados;
+		bool cancelado;
+		bool terminado;
+		t_pipeline * pipeline; // Mientras se transforma, para poder cancelarlo
 	}tEtapaTransformacionWorker;
 
+typedef struct {
+	t_socket socket;
+	int job;
+	char * script;
+	char * combinador; // Reductor aplicado a la salida de cada bloque (NULL si el job no lo usa)
+	tEtapaTransformacionWorker ** tareas; // Punteros: el arreglo crece si Master amplía el lote
+	int cantidad;
+	int siguiente;
+	int activos; // Hilos que todavía buscan tareas
+	bool error;
+	mutex_t * mutex;
+	sem_t * terminados;
+} tLoteTransformacion;
+
 typedef struct {
 	char * script;
 	int lenLista;
@@ -79,11 +111,26 @@ typedef struct {
 	char * archivoFinal;
 } tEtapaAlmacenamientoWorker;
 
-t_socket socketEscuchaMaster,socketEscuchaWorker, socketFileSystem,socketWorker;
+t_socket socketEscuchaMaster;
 
 void signal_handler();
 void listen_to_master();
-t_file* crearScript(char * bufferScript,int,int);
+void atender_master(t_socket socket);
+void atender_worker(void * arg);
+void etapa_transformacion_lote(t_socket socket, t_serial * content);
+void ejecutar_lote(tLoteTransformacion * lote);
+void esperar_lote(tLoteTransformacion * lote, int hilos);
+void leer_tareas(tLoteTransformacion * lote, t_serial_reader * reader, int cantidad);
+int ampliar_lote(tLoteTransformacion * lote, t_serial * content);
+void cancelar_bloque(tLoteTransformacion * lote, int bloque);
+int hilos_lote(int cantidad);
+void etapa_reduccion_local(t_socket socket, t_serial * content);
+void etapa_apareo_parcial(t_socket socket, t_serial * content);
+void etapa_reduccion_global(t_socket socket, t_serial * content);
+void etapa_almacenamiento(t_socket socket, t_serial * content);
+char * obtener_script(t_socket socket, const char * md5);
+t_file * abrir_temporal(const char * path);
+int hilos_pool();
 tEtapaReduccionLocalWorker * etapa_rl_unpack_bis(t_serial * serial);
 tEtapaReduccionGlobalWorker * rg_unpack(t_serial*);
 void manejador_master(t_packet *packet,int socket);
@@ -91,11 +138,12 @@ void manejador_worker(t_packet * packet,int socket);
 t_socket connect_to_worker(const char *ip, const char *port);
 void mandarDatosAWorkerHomologo(tEtapaReduccionGlobal * rg,int);
 void asignarOffset(int * offset,int bloque,int bytesOcuapdos);
-void ejecutarComando(char * command, int socketAceptado);
 char*  crearListaParaReducir(tEtapaReduccionGlobalWorker * rg);
 tEtapaAlmacenamientoWorker * af_unpack(t_serial * serial);
-int connect_to_filesystem();
-bool block_transform(int blockno, size_t size, const char *script, const char *output,int);
+t_socket connect_to_filesystem();
+bool block_transform(t_pipeline *pipeline, int blockno, size_t size, const char *script, const char *combiner, const char *output);
 bool reducir_path(const char *input, const char *script, const char *output);
+void log_pipeline(t_pipeline *pipeline, const char *tarea, bool ok);
+void trace_pipeline(t_pipeline *pipeline, const char *tarea, uint64_t inicio);
 
 #endif
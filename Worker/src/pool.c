@@ -0,0 +1,42 @@
+#include "pool.h"
+#include <stdlib.h>
+#include <log.h>
+#include <mlist.h>
+#include <thread.h>
+
+static mlist_t *pendientes = NULL;
+static sem_t *disponibles = NULL;
+static void (*atender)(t_socket socket) = NULL;
+
+static void pool_routine(void);
+
+// ========== Funciones públicas ==========
+
+void pool_init(int hilos, void (*routine)(t_socket socket)) {
+	pendientes = mlist_create();
+	disponibles = thread_sem_create(0);
+	atender = routine;
+	for(int i = 0; i < hilos; i++) {
+		thread_create(pool_routine, NULL);
+	}
+	log_print("Pool de %d hilos creado", hilos);
+}
+
+void pool_submit(t_socket socket) {
+	t_socket *elem = malloc(sizeof(t_socket));
+	*elem = socket;
+	mlist_append(pendientes, elem);
+	thread_sem_signal(disponibles);
+}
+
+// ========== Funciones privadas ==========
+
+static void pool_routine() {
+	while(true) {
+		thread_sem_wait(disponibles);
+		t_socket *elem = mlist_pop(pendientes, 0);
+		t_socket socket = *elem;
+		free(elem);
+		atender(socket);
+	}
+}
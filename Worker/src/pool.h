@@ -0,0 +1,21 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <socket.h>
+
+/**
+ * Crea el pool de hilos que atienden las conexiones de Master.
+ * Los hilos se crean una única vez y quedan esperando conexiones,
+ * evitando crear un proceso o hilo nuevo por cada tarea.
+ * @param hilos Cantidad de hilos del pool.
+ * @param routine Rutina que atiende una tarea (debe cerrar el socket o devolver la sesión).
+ */
+void pool_init(int hilos, void (*routine)(t_socket socket));
+
+/**
+ * Encola una conexión aceptada para que la atienda un hilo libre.
+ * @param socket Socket de la conexión.
+ */
+void pool_submit(t_socket socket);
+
+#endif /* POOL_H_ */
@@ -0,0 +1,78 @@
+#include "scheduler.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <config.h>
+#include <log.h>
+#include <mlist.h>
+#include <mstring.h>
+#include <thread.h>
+
+typedef struct {
+	int prioridad;
+	sem_t *sem;
+} t_turno;
+
+static mutex_t *mutex = NULL;
+static mlist_t *cola = NULL;
+static int limite = 1;
+static int activas = 0;
+static bool por_prioridad = false;
+
+// ========== Funciones públicas ==========
+
+void scheduler_init() {
+	const char *tareas = config_get("TAREAS_POR_NUCLEO");
+	const char *politica = config_get("COLA_TAREAS");
+	int por_nucleo = tareas == NULL ? 0 : mstring_toint(tareas);
+	long nucleos = sysconf(_SC_NPROCESSORS_ONLN);
+
+	limite = (por_nucleo > 0 ? por_nucleo : 1) * (nucleos > 0 ? nucleos : 1);
+	por_prioridad = politica != NULL && mstring_equali(politica, "PRIORIDAD");
+	mutex = thread_mutex_create();
+	cola = mlist_create();
+	log_print("Planificador de tareas: %d en simultáneo, cola %s", limite, por_prioridad ? "por prioridad" : "FIFO");
+}
+
+void scheduler_acquire(int prioridad) {
+	thread_mutex_lock(mutex);
+	if(activas < limite && mlist_empty(cola)) {
+		activas++;
+		thread_mutex_unlock(mutex);
+		return;
+	}
+
+	t_turno turno = {prioridad, thread_sem_create(0)};
+	if(por_prioridad) {
+		bool despues(t_turno *otro) { return otro->prioridad > prioridad; }
+		int index = mlist_index(cola, despues);
+		if(index == -1) mlist_append(cola, &turno);
+		else mlist_insert(cola, index, &turno);
+	} else {
+		mlist_append(cola, &turno);
+	}
+	thread_mutex_unlock(mutex);
+
+	// El lugar lo transfiere directamente quien lo libera
+	thread_sem_wait(turno.sem);
+	thread_sem_destroy(turno.sem);
+}
+
+void scheduler_release() {
+	thread_mutex_lock(mutex);
+	t_turno *siguiente = mlist_pop(cola, 0);
+	if(siguiente != NULL) thread_sem_signal(siguiente->sem);
+	else activas--;
+	thread_mutex_unlock(mutex);
+}
+
+int scheduler_pending() {
+	thread_mutex_lock(mutex);
+	int pendientes = mlist_length(cola);
+	thread_mutex_unlock(mutex);
+	return pendientes;
+}
+
+int scheduler_limit() {
+	return limite;
+}
@@ -0,0 +1,36 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+/**
+ * Inicializa el planificador de tareas del Worker.
+ * Admite hasta TAREAS_POR_NUCLEO tareas por núcleo en simultáneo y encola
+ * el resto según COLA_TAREAS (FIFO o PRIORIDAD).
+ */
+void scheduler_init(void);
+
+/**
+ * Bloquea al hilo hasta que haya un lugar libre para ejecutar una tarea.
+ * Con la cola por prioridad se atiende primero el menor valor; a igual
+ * prioridad se respeta el orden de llegada.
+ * @param prioridad Prioridad de la tarea (por ejemplo, el número de job).
+ */
+void scheduler_acquire(int prioridad);
+
+/**
+ * Libera el lugar ocupado por una tarea terminada.
+ */
+void scheduler_release(void);
+
+/**
+ * Devuelve la cantidad de tareas que están esperando un lugar.
+ * @return Profundidad de la cola.
+ */
+int scheduler_pending(void);
+
+/**
+ * Devuelve la cantidad máxima de tareas en simultáneo.
+ * @return Límite de tareas.
+ */
+int scheduler_limit(void);
+
+#endif /* SCHEDULER_H_ */
@@ -0,0 +1,90 @@
+#include "scripts.h"
+#include <openssl/md5.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <log.h>
+#include <mstring.h>
+#include <path.h>
+#include <system.h>
+#include <thread.h>
+
+static char *dir = NULL;
+static mutex_t *mutex = NULL;
+
+static char *content_md5(const char *contenido, size_t size);
+static bool write_script(const char *path, const char *contenido, size_t size);
+
+// ========== Funciones públicas ==========
+
+void scripts_init() {
+	dir = mstring_create("%s/scripts", system_userdir());
+	path_remove(dir);
+	path_mkdir(dir);
+	mutex = thread_mutex_create();
+}
+
+char *scripts_find(const char *md5) {
+	char *path = mstring_create("%s/%s", dir, md5);
+	thread_mutex_lock(mutex);
+	bool found = path_exists(path);
+	thread_mutex_unlock(mutex);
+	if(!found) {
+		free(path);
+		return NULL;
+	}
+	return path;
+}
+
+char *scripts_add(const char *md5, const char *contenido, size_t size) {
+	char *hash = content_md5(contenido, size);
+	bool valid = mstring_equali(hash, md5);
+	free(hash);
+	if(!valid) {
+		log_report("El contenido recibido no corresponde al script %s", md5);
+		return NULL;
+	}
+
+	char *path = mstring_create("%s/%s", dir, md5);
+	thread_mutex_lock(mutex);
+	bool ok = path_exists(path) || write_script(path, contenido, size);
+	thread_mutex_unlock(mutex);
+
+	if(!ok) {
+		log_report("No se pudo escribir el script %s", path);
+		free(path);
+		return NULL;
+	}
+	return path;
+}
+
+// ========== Funciones privadas ==========
+
+static char *content_md5(const char *contenido, size_t size) {
+	unsigned char digest[MD5_DIGEST_LENGTH];
+	MD5((const unsigned char*) contenido, size, digest);
+
+	char *md5 = malloc(MD5_DIGEST_LENGTH * 2 + 1);
+	for(int i = 0; i < MD5_DIGEST_LENGTH; i++) {
+		sprintf(md5 + i * 2, "%02x", digest[i]);
+	}
+	return md5;
+}
+
+static bool write_script(const char *path, const char *contenido, size_t size) {
+	char *tmp = mstring_create("%s.tmp", path);
+	FILE *fp = fopen(tmp, "w");
+	if(fp == NULL) {
+		free(tmp);
+		return false;
+	}
+
+	bool ok = fwrite(contenido, 1, size, fp) == size;
+	ok = fclose(fp) == 0 && ok;
+	ok = ok && chmod(tmp, 0777) == 0 && rename(tmp, path) == 0;
+	if(!ok) remove(tmp);
+	free(tmp);
+	if(ok) log_print("Script %s agregado a la caché", path);
+	return ok;
+}
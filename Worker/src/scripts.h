@@ -0,0 +1,31 @@
+#ifndef SCRIPTS_H_
+#define SCRIPTS_H_
+
+#include <stddef.h>
+
+/**
+ * Inicializa la caché de scripts del Worker (~/yatpos/scripts).
+ * Los scripts de ejecuciones anteriores se descartan.
+ */
+void scripts_init(void);
+
+/**
+ * Busca en la caché el script con el hash MD5 especificado.
+ * La cadena devuelta debe ser liberada con free().
+ * @param md5 Hash MD5 del contenido del script.
+ * @return Ruta absoluta al script (NULL si no está en la caché).
+ */
+char *scripts_find(const char *md5);
+
+/**
+ * Agrega un script a la caché, verificando que su contenido
+ * corresponda con el hash MD5 con el que fue pedido.
+ * La cadena devuelta debe ser liberada con free().
+ * @param md5 Hash MD5 esperado.
+ * @param contenido Contenido del script.
+ * @param size Tamaño del contenido.
+ * @return Ruta absoluta al script (NULL si no se pudo agregar).
+ */
+char *scripts_add(const char *md5, const char *contenido, size_t size);
+
+#endif /* SCRIPTS_H_ */
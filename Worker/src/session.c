@@ -0,0 +1,85 @@
+#include "session.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <log.h>
+#include <mlist.h>
+#include <thread.h>
+
+static mutex_t *mutex = NULL;
+static mlist_t *inactivas = NULL;	// Sesiones sin tarea en curso
+static int aviso[2] = {-1, -1};		// Despierta a session_wait cuando vuelve una sesión
+
+static void drain_aviso(void);
+
+// ========== Funciones públicas ==========
+
+void session_init() {
+	mutex = thread_mutex_create();
+	inactivas = mlist_create();
+	if(pipe(aviso) == -1) {
+		log_report("No se pudo crear el aviso de sesiones");
+		return;
+	}
+	for(int i = 0; i < 2; i++) {
+		fcntl(aviso[i], F_SETFL, O_NONBLOCK);
+		fcntl(aviso[i], F_SETFD, FD_CLOEXEC);
+	}
+}
+
+t_socket session_wait(t_socket listener, bool *nueva) {
+	while(true) {
+		thread_mutex_lock(mutex);
+		int cantidad = mlist_length(inactivas);
+		struct pollfd fds[cantidad + 2];
+		fds[0] = (struct pollfd) {listener, POLLIN, 0};
+		fds[1] = (struct pollfd) {aviso[0], POLLIN, 0};
+		for(int i = 0; i < cantidad; i++) {
+			t_socket *socket = mlist_get(inactivas, i);
+			fds[i + 2] = (struct pollfd) {*socket, POLLIN, 0};
+		}
+		thread_mutex_unlock(mutex);
+
+		if(poll(fds, cantidad + 2, -1) == -1) return -1;
+		if(fds[1].revents != 0) drain_aviso();
+
+		// Primero los pedidos de las sesiones abiertas, que ya pasaron el handshake
+		for(int i = 2; i < cantidad + 2; i++) {
+			if(fds[i].revents == 0) continue;
+			t_socket listo = fds[i].fd;
+			bool esSocket(t_socket *socket) {
+				return *socket == listo;
+			}
+			thread_mutex_lock(mutex);
+			mlist_remove(inactivas, esSocket, free);
+			thread_mutex_unlock(mutex);
+			*nueva = false;
+			return listo;
+		}
+
+		if(fds[0].revents != 0) {
+			*nueva = true;
+			return socket_accept(listener);
+		}
+	}
+}
+
+void session_release(t_socket socket) {
+	t_socket *elem = malloc(sizeof(t_socket));
+	*elem = socket;
+	thread_mutex_lock(mutex);
+	mlist_append(inactivas, elem);
+	thread_mutex_unlock(mutex);
+	// Si la tubería está llena la escritura falla, pero session_wait se despierta igual
+	char c = 0;
+	ssize_t r = write(aviso[1], &c, 1);
+	(void) r;
+}
+
+// ========== Funciones privadas ==========
+
+static void drain_aviso() {
+	char buffer[64];
+	while(read(aviso[0], buffer, sizeof buffer) > 0);
+}
@@ -0,0 +1,29 @@
+#ifndef SESSION_H_
+#define SESSION_H_
+
+#include <stdbool.h>
+#include <socket.h>
+
+/**
+ * Inicializa el registro de sesiones de Master.
+ * Una sesión es una conexión que Master reutiliza para varias tareas; entre
+ * una tarea y la siguiente no ocupa ningún hilo del pool.
+ */
+void session_init(void);
+
+/**
+ * Espera una conexión nueva o un pedido en alguna sesión abierta.
+ * @param listener Socket de escucha.
+ * @param nueva Se carga con true si es una conexión recién aceptada (falta el handshake).
+ * @return Socket listo para atender, o -1 si falló la espera.
+ */
+t_socket session_wait(t_socket listener, bool *nueva);
+
+/**
+ * Devuelve una sesión al registro luego de atender una tarea.
+ * Si Master cierra la conexión, se detecta en la próxima espera.
+ * @param socket Socket de la sesión.
+ */
+void session_release(t_socket socket);
+
+#endif /* SESSION_H_ */
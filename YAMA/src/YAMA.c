@@ -37,6 +37,11 @@ char* algoritmoBalanceo;
 void trapper(int signum);
 bool entreAPlanificar = false;
 bool recibiSenial = false;
+int especulacionProgreso;
+int especulacionPercentil;
+int apareoParcial;
+int gradoReduccionGlobal;
+int slotsPorNodo;
 
 
 
@@ -46,6 +51,7 @@ int main() {
 	inicializoVariablesGlobalesConfig();
 	if(connect_to_filesystem() == RESPONSE_ERROR) return EXIT_SUCCESS;;
 	listaEstados = mlist_create();
+	listaJobs = mlist_create();
 	listen_to_master();
 	free(algoritmoBalanceo);
 	return EXIT_SUCCESS;
@@ -71,4 +77,18 @@ void inicializoVariablesGlobalesConfig(){
 	retardoPlanificacion = atoi(config_get("RETARDO_PLANIFICACION"));
 	algoritmoBalanceo = malloc(sizeof(char)*8);
 	strcpy(algoritmoBalanceo,config_get("ALGORITMO_BALANCEO"));
+	// Sin ESPECULACION_PROGRESO no se lanzan copias de las transformaciones atrasadas
+	const char* progreso = config_get("ESPECULACION_PROGRESO");
+	const char* percentil = config_get("ESPECULACION_PERCENTIL");
+	especulacionProgreso = progreso != NULL ? atoi(progreso) : 0;
+	especulacionPercentil = percentil != NULL ? atoi(percentil) : 90;
+	// Sin APAREO_PARCIAL la reducción local junta todas las salidas de una vez al final
+	const char* apareo = config_get("APAREO_PARCIAL");
+	apareoParcial = apareo != NULL ? atoi(apareo) : 0;
+	// Sin GRADO_REDUCCION_GLOBAL un único encargado junta las reducciones locales de todos los nodos
+	const char* grado = config_get("GRADO_REDUCCION_GLOBAL");
+	gradoReduccionGlobal = grado != NULL ? atoi(grado) : 0;
+	// Sin SLOTS_POR_NODO cada job manda todas sus transformaciones apenas se planifica
+	const char* slots = config_get("SLOTS_POR_NODO");
+	slotsPorNodo = slots != NULL ? atoi(slots) : 0;
 }
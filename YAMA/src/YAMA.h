@@ -11,12 +11,18 @@ typedef struct {
 
 extern t_yama yama;
 mlist_t * listaEstados;
+mlist_t * listaJobs;
 extern int numeroJob;
 extern mlist_t* listaNodosActivos;
 extern int retardoPlanificacion;
 extern char* algoritmoBalanceo;
 extern bool entreAPlanificar;
 extern bool recibiSenial;
+extern int especulacionProgreso;
+extern int especulacionPercentil;
+extern int apareoParcial;
+extern int gradoReduccionGlobal;
+extern int slotsPorNodo;
 
 
 void inicializoVariablesGlobalesConfig();
@@ -3,11 +3,15 @@
 #include "server.h"
 #include <semaphore.h>
 #include "mstring.h"
+#include <layout.h>
+#include <metrics.h>
 
 mlist_t * listaCargaPorNodo;
 
-static int contadorBloquesSeguidosNoAsignados = 0;
-static bool asigneBloquesDeArchivo = false;
+typedef struct{
+	const char* nombre;
+	int indice;
+} t_nombreNodo;
 
 void imprimirListaEstadosCompleta(){
 	int i;
@@ -19,19 +23,202 @@ void imprimirListaEstadosCompleta(){
 	}
 }
 
-void planificar(t_workerPlanificacion planificador[], int tamaniolistaNodos, mlist_t* listaBloque){
+bool planificar(t_workerPlanificacion planificador[], int tamaniolistaNodos, mlist_t* listaBloque){
+	if(string_equals_ignore_case("COSTO",algoritmoBalanceo)){
+		return planificarPorCosto(planificador, tamaniolistaNodos, listaBloque);
+	}
+
+	int base = availabilityClock();
+	int posicion = 0;
+	llenarArrayPlanificador(planificador, tamaniolistaNodos, base, &posicion);
+
+	int cantidadBloques;
+	t_block** bloques = bloquesComoArreglo(listaBloque, &cantidadBloques);
+	int* copias = indicesDeCopias(planificador, tamaniolistaNodos, bloques, cantidadBloques);
+	// Un bloque sin copias en nodos activos haría girar el puntero para siempre
+	for(int j = 0; j < cantidadBloques; j++){
+		if(copias[2 * j] == -1 && copias[2 * j + 1] == -1){
+			log_report("El bloque %d no tiene copias en nodos activos", bloques[j]->index);
+			free(copias);
+			free(bloques);
+			return false;
+		}
+	}
+
+	// Clock: el puntero avanza por los nodos y asigna el bloque al primero que tenga
+	// una copia y disponibilidad; solo se comparan índices enteros
+	int seguidosSinAsignar = 0;
+	int j = 0;
+	while(j < cantidadBloques){
+		if(posicion == tamaniolistaNodos){
+			posicion = 0;
+		}
+		t_workerPlanificacion* worker = &planificador[posicion];
+		if(worker->disponibilidad == 0){
+			worker->disponibilidad = base;
+			seguidosSinAsignar++;
+		} else if(copias[2 * j] == posicion || copias[2 * j + 1] == posicion){
+			worker->disponibilidad--;
+			mlist_append(worker->bloque, (void*) (intptr_t) bloques[j]->index);
+			j++;
+			seguidosSinAsignar = 0;
+		} else if(++seguidosSinAsignar == tamaniolistaNodos){
+			for(int i = 0; i < tamaniolistaNodos; i++){
+				planificador[i].disponibilidad += base;
+			}
+			seguidosSinAsignar = 0;
+		}
+		posicion++;
+	}
+
+	free(copias);
+	free(bloques);
+	return true;
+}
+
+static int compararNombreNodo(const void* nodo1, const void* nodo2){
+	return strcmp(((t_nombreNodo*) nodo1)->nombre, ((t_nombreNodo*) nodo2)->nombre);
+}
+
+t_block** bloquesComoArreglo(mlist_t* listaBloque, int* cantidad){
+	*cantidad = mlist_length(listaBloque);
+	t_block** bloques = malloc(*cantidad * sizeof(t_block*));
+	int posicion = 0;
+	void copiarBloque(t_block* bloque){
+		bloques[posicion++] = bloque;
+	}
+	mlist_traverse(listaBloque, copiarBloque);
+	return bloques;
+}
+
+int* indicesDeCopias(t_workerPlanificacion planificador[], int tamaniolistaNodos, t_block** bloques, int cantidadBloques){
+	t_nombreNodo nombres[tamaniolistaNodos];
+	for(int i = 0; i < tamaniolistaNodos; i++){
+		nombres[i].nombre = planificador[i].nombreWorker;
+		nombres[i].indice = i;
+	}
+	qsort(nombres, tamaniolistaNodos, sizeof(t_nombreNodo), compararNombreNodo);
+
+	int* copias = malloc(2 * cantidadBloques * sizeof(int));
+	for(int j = 0; j < cantidadBloques; j++){
+		for(int c = 0; c < 2; c++){
+			t_nombreNodo clave = { bloques[j]->copies[c].node, -1 };
+			t_nombreNodo* encontrado = clave.nombre == NULL ? NULL :
+					bsearch(&clave, nombres, tamaniolistaNodos, sizeof(t_nombreNodo), compararNombreNodo);
+			copias[2 * j + c] = encontrado != NULL ? encontrado->indice : -1;
+		}
+	}
+	return copias;
+}
+
+typedef struct{
+	int indice;
+	double fin;		// Milisegundos estimados hasta que el nodo termina lo que tiene asignado
+	double tasa;	// Bytes por milisegundo
+	int historico;
+} t_nodoCosto;
+
+static bool nodoTerminaAntes(t_nodoCosto* nodo1, t_nodoCosto* nodo2){
+	if(nodo1->fin != nodo2->fin) return nodo1->fin < nodo2->fin;
+	if(nodo1->historico != nodo2->historico) return nodo1->historico < nodo2->historico;
+	return nodo1->indice < nodo2->indice;
+}
+
+static int bloqueMasGrande(const void* bloque1, const void* bloque2){
+	t_block* b1 = *(t_block**) bloque1;
+	t_block* b2 = *(t_block**) bloque2;
+	if(b1->size != b2->size) return b1->size > b2->size ? -1 : 1;
+	return b1->index - b2->index;
+}
+
+double tasaPromedio(){
+	double suma = 0;
+	int conDatos = 0;
+	void sumar(t_cargaPorNodo* carga){
+		if(carga->rendimiento > 0){
+			suma += carga->rendimiento;
+			conDatos++;
+		}
+	}
+	mlist_traverse(listaCargaPorNodo, sumar);
+	return conDatos > 0 ? suma / conDatos : 1;
+}
+
+bool planificarPorCosto(t_workerPlanificacion planificador[], int tamaniolistaNodos, mlist_t* listaBloque){
+	int cantidadBloques;
+	t_block** bloques = bloquesComoArreglo(listaBloque, &cantidadBloques);
+	// Primero los bloques más grandes (LPT); a igual tamaño, por índice para que sea determinista
+	qsort(bloques, cantidadBloques, sizeof(t_block*), bloqueMasGrande);
+
+	t_nodoCosto nodos[tamaniolistaNodos];
+	int* candidatos[tamaniolistaNodos];
+	int cantidadCandidatos[tamaniolistaNodos];
+	int siguiente[tamaniolistaNodos];
+	double tasaSinDatos = tasaPromedio();
+	for(int i = 0; i < tamaniolistaNodos; i++){
+		t_infoNodo* nodoObtenido = mlist_get(listaNodosActivos,i);
+		planificador[i].nombreWorker = mstring_duplicate(nodoObtenido->nodo);
+		planificador[i].bloque = mlist_create();
+		planificador[i].disponibilidad = 0;
+
+		t_cargaPorNodo* carga = mlist_get(listaCargaPorNodo, obtenerPosicionCargaNodo(nodoObtenido->nodo));
+		nodos[i].indice = i;
+		nodos[i].tasa = carga->rendimiento > 0 ? carga->rendimiento : tasaSinDatos;
+		nodos[i].historico = carga->cargaHistorica;
+		// Lo que el nodo ya tiene pendiente se estima en bloques completos
+		nodos[i].fin = (double) cargaActual(nodoObtenido->nodo) * BLOCK_SIZE / nodos[i].tasa;
+		candidatos[i] = malloc(cantidadBloques * sizeof(int));
+		cantidadCandidatos[i] = 0;
+		siguiente[i] = 0;
+	}
+
+	// Cada nodo solo puede recibir los bloques de los que tiene una copia
+	int* copias = indicesDeCopias(planificador, tamaniolistaNodos, bloques, cantidadBloques);
+	for(int j = 0; j < cantidadBloques; j++){
+		int copia0 = copias[2 * j];
+		int copia1 = copias[2 * j + 1];
+		if(copia0 != -1) candidatos[copia0][cantidadCandidatos[copia0]++] = j;
+		if(copia1 != -1 && copia1 != copia0) candidatos[copia1][cantidadCandidatos[copia1]++] = j;
+	}
 
-	int posicionArray;
-	llenarArrayPlanificador(planificador,tamaniolistaNodos,&posicionArray);
-	int bloque = 0;
-	while(!asigneBloquesDeArchivo){
-		if(posicionArray == tamaniolistaNodos){
-			posicionArray = 0;
+	// El nodo que antes termina toma el bloque local más grande que quede sin asignar
+	bool* asignado = calloc(cantidadBloques, sizeof(bool));
+	int restantes = cantidadBloques;
+	t_heap* heap = heap_create(nodoTerminaAntes);
+	for(int i = 0; i < tamaniolistaNodos; i++){
+		if(cantidadCandidatos[i] > 0) heap_push(heap, &nodos[i]);
+	}
+	while(!heap_empty(heap)){
+		t_nodoCosto* nodo = heap_pop(heap);
+		int k = nodo->indice;
+		while(siguiente[k] < cantidadCandidatos[k] && asignado[candidatos[k][siguiente[k]]]){
+			siguiente[k]++;
 		}
-		verificarCondicion(tamaniolistaNodos, &posicionArray,planificador, &bloque, listaBloque);
+		if(siguiente[k] == cantidadCandidatos[k]) continue;
+
+		int j = candidatos[k][siguiente[k]++];
+		asignado[j] = true;
+		restantes--;
+		nodo->fin += bloques[j]->size / nodo->tasa;
+		mlist_append(planificador[k].bloque, (void*) (intptr_t) bloques[j]->index);
+		heap_push(heap, nodo);
 	}
 
-	asigneBloquesDeArchivo = false;
+	for(int i = 0; i < tamaniolistaNodos; i++){
+		log_inform("Planificado por costo Nodo: %s, Bloques: %d, Fin estimado: %.0f ms",
+				planificador[i].nombreWorker, mlist_length(planificador[i].bloque), nodos[i].fin);
+		free(candidatos[i]);
+	}
+	heap_destroy(heap, NULL);
+	free(asignado);
+	free(copias);
+	free(bloques);
+
+	if(restantes > 0){
+		log_report("Hay %d bloques sin copias en nodos activos", restantes);
+		return false;
+	}
+	return true;
 }
 
 int availabilityClock(){
@@ -45,23 +232,24 @@ int cargaActual(char* nodo){
 	void* cargaNodoObtenida = mlist_find(listaCargaPorNodo,condicion);
 
 	t_cargaPorNodo* cargaNodo = (t_cargaPorNodo*) cargaNodoObtenida;
-	return cargaNodo->cargaActual;
+	// Las tareas encoladas en el Worker reflejan la espera real por núcleos
+	return cargaNodo->cargaActual + cargaNodo->colaWorker;
 }
 
-int Disponibilidad(int cargaMax, char* nodo){
+int Disponibilidad(int base, int cargaMax, char* nodo){
 
 	if(string_equals_ignore_case("CLOCK",algoritmoBalanceo)){
-		return availabilityClock();
+		return base;
 	}
 	else{
-		return availabilityClock() + ( cargaMax - cargaActual(nodo) );
+		return base + ( cargaMax - cargaActual(nodo) );
 	}
 }
 
 int obtenerCargaMaxima(){
 
 	int carga(void* carga1){
-		return ((t_cargaPorNodo*) carga1)->cargaActual;
+		return ((t_cargaPorNodo*) carga1)->cargaActual + ((t_cargaPorNodo*) carga1)->colaWorker;
 	}
 	mlist_t* listaDeCargas = mlist_map(listaCargaPorNodo, (void*) carga);
 	bool mayor(void* carga1,void* carga2){
@@ -78,7 +266,7 @@ int obtenerCargaMaxima(){
 
 
 
-void llenarArrayPlanificador(t_workerPlanificacion planificador[],int tamaniolistaNodos,int *posicion){
+void llenarArrayPlanificador(t_workerPlanificacion planificador[],int tamaniolistaNodos,int base,int *posicion){
 	int i,MaximaDisponibilidad = 0, cargaMax = 0;
 	int historicoAnterior = 0;
 	if(!strcmp("WCLOCK",algoritmoBalanceo)){
@@ -86,10 +274,9 @@ void llenarArrayPlanificador(t_workerPlanificacion planificador[],int tamaniolis
 	}
 	for(i=0;i<tamaniolistaNodos;i++){
 		t_infoNodo* nodoObtenido = mlist_get(listaNodosActivos,i);
-		planificador[i].nombreWorker = malloc(sizeof(char)*6);
-		strcpy( planificador[i].nombreWorker, nodoObtenido->nodo);
+		planificador[i].nombreWorker = mstring_duplicate(nodoObtenido->nodo);
 		planificador[i].bloque = mlist_create();
-		planificador[i].disponibilidad = Disponibilidad(cargaMax, planificador[i].nombreWorker);
+		planificador[i].disponibilidad = Disponibilidad(base, cargaMax, planificador[i].nombreWorker);
 
 
 		if(planificador[i].disponibilidad > MaximaDisponibilidad){
@@ -105,73 +292,25 @@ void llenarArrayPlanificador(t_workerPlanificacion planificador[],int tamaniolis
 	}
 }
 
-
-void verificarCondicion(int tamaniolistaNodos, int *posicion,t_workerPlanificacion planificador[],int* bloque,mlist_t* listaBloque){
-	t_block* infoArchivo = mlist_get(listaBloque, *bloque);
-
-		if(planificador[*posicion].disponibilidad == 0){
-			planificador[*posicion].disponibilidad = atoi(config_get("DISP_BASE"));
-			*posicion = *posicion +1;
-			contadorBloquesSeguidosNoAsignados++;
-		}else if(infoArchivo->copies[0].node == NULL){
-			if(!strcmp(infoArchivo->copies[1].node, planificador[*posicion].nombreWorker))
-			{
-				asignoBloque(planificador,posicion,bloque,mlist_length(listaBloque));
-
-			}
-			else{
-				avanzoPosicion(posicion,tamaniolistaNodos,planificador);
-			}
-
-		}
-
-		else if(infoArchivo->copies[1].node == NULL){
-			if(!strcmp(infoArchivo->copies[0].node, planificador[*posicion].nombreWorker))
-			{
-				asignoBloque(planificador,posicion,bloque,mlist_length(listaBloque));
-
-			}
-			else{
-				avanzoPosicion(posicion,tamaniolistaNodos,planificador);
-			}
-		}
-		else if(!strcmp(infoArchivo->copies[0].node, planificador[*posicion].nombreWorker) || !strcmp(infoArchivo->copies[1].node, planificador[*posicion].nombreWorker)){
-			asignoBloque(planificador,posicion,bloque,mlist_length(listaBloque));
-		}
-		else{
-			avanzoPosicion(posicion,tamaniolistaNodos,planificador);
-		}
-}
-
-void avanzoPosicion(int *posicion,int tamaniolistaNodos,t_workerPlanificacion planificador[]){
-*posicion = *posicion + 1;
-		contadorBloquesSeguidosNoAsignados++;
-		if(contadorBloquesSeguidosNoAsignados == tamaniolistaNodos){
-			int i;
-			for(i = 0; i < tamaniolistaNodos; i++){
-				planificador[i].disponibilidad += atoi(config_get("DISP_BASE"));
-			}
-			contadorBloquesSeguidosNoAsignados = 0;
-		}
-}
-
-void asignoBloque(t_workerPlanificacion planificador[], int *posicion,int* bloque,int tamanioListaBloque){
-
-	planificador[*posicion].disponibilidad--;
-	mlist_append(planificador[*posicion].bloque,(void*)*bloque);
-	*bloque = *bloque + 1;
-	if(tamanioListaBloque == *bloque){
-		asigneBloquesDeArchivo = true;
-	}
-	*posicion = *posicion +1;
-	contadorBloquesSeguidosNoAsignados = 0;
-}
-
 respuestaOperacionTranf* serial_unpackRespuestaOperacion(t_serial *serial){
 	respuestaOperacionTranf* operacion = malloc(sizeof(respuestaOperacionTranf));
-		serial_unpack(serial, "isiis",&operacion->idJOB ,&operacion->nodo, &operacion->bloque,
-				&operacion->response,&operacion->file);
-		return operacion;
+	t_layout_transformacion_lista lista;
+	if(!layout_transformacion_lista_read(&lista, serial->data, serial->size)) {
+		// Mensaje truncado: se trata como una transformación fallida
+		memset(&lista, 0, sizeof lista);
+		lista.response = -1;
+		lista.cola = -1;
+	}
+	operacion->idJOB = lista.job;
+	operacion->nodo = mstring_duplicate(lista.nodo);
+	operacion->bloque = lista.bloque;
+	operacion->response = lista.response;
+	operacion->file = mstring_duplicate(lista.archivo);
+	operacion->colaWorker = lista.cola;
+	operacion->bytes = lista.bytes;
+	operacion->duracion = lista.duracion;
+	serial_destroy(serial);
+	return operacion;
 }
 
 respuestaOperacion* serial_unpackrespuestaOperacion(t_serial * serial){
@@ -182,7 +321,7 @@ respuestaOperacion* serial_unpackrespuestaOperacion(t_serial * serial){
 
 t_pedidoTrans* serial_unpackPedido(t_serial* serial){
 	t_pedidoTrans* operacion = malloc(sizeof(t_pedidoTrans));
-	serial_unpack(serial,"is",&operacion->idJOB,&operacion->file);
+	serial_unpack(serial,"isisi",&operacion->idJOB,&operacion->file,&operacion->combinar,&operacion->compresion,&operacion->peso);
 	return operacion;
 }
 
@@ -229,12 +368,48 @@ t_yfile* reciboInformacionSolicitada(int job,int master){
 }
 
 char* generarNombreArchivoTemporalTransf(int job,int master, int bloque){
-	char* nombreArchivoTemporal = malloc(sizeof(char)*21);
-	 sprintf(nombreArchivoTemporal,"/tmp/j%dMaster%d-temp%d",job,master,bloque);
-	 return nombreArchivoTemporal;
+	return mstring_create("/tmp/j%dMaster%d-temp%d%s",job,master,bloque,extensionJob(job,master));
+}
+
+void registrarJob(t_pedidoTrans* pedido, int master){
+	t_Job* job = malloc(sizeof(t_Job));
+	job->job = pedido->idJOB;
+	job->master = master;
+	if(mstring_equali(pedido->compresion, "lz4")) job->extension = ".lz4";
+	else if(mstring_equali(pedido->compresion, "zstd")) job->extension = ".zst";
+	else {
+		if(!mstring_isempty(pedido->compresion)) log_report("Job: %d códec desconocido %s, no se comprimen los intermedios",job->job,pedido->compresion);
+		job->extension = "";
+	}
+	if(!mstring_isempty(job->extension)) log_inform("Job: %d intermedios comprimidos con %s",job->job,pedido->compresion);
+	job->peso = pedido->peso > 0 ? pedido->peso : 1;
+	mlist_append(listaJobs, job);
 }
 
-void agregarAtablaEstado(int job, char* nodo,int Master,int bloque,char* etapa,char* archivo_temporal,char* estado){
+int pesoJob(int job, int master){
+	bool esJob(t_Job* registrado){
+		return registrado->job == job && registrado->master == master;
+	}
+	t_Job* registrado = mlist_find(listaJobs, esJob);
+	return registrado == NULL ? 1 : registrado->peso;
+}
+
+const char* extensionJob(int job, int master){
+	bool esJob(t_Job* registrado){
+		return registrado->job == job && registrado->master == master;
+	}
+	t_Job* registrado = mlist_find(listaJobs, esJob);
+	return registrado == NULL ? "" : registrado->extension;
+}
+
+void quitarJobs(int master){
+	bool esDelMaster(t_Job* registrado){
+		return registrado->master == master;
+	}
+	mlist_remove(listaJobs, esDelMaster, free);
+}
+
+t_Estado* agregarAtablaEstado(int job, char* nodo,int Master,int bloque,char* etapa,char* archivo_temporal,char* estado){
 	t_Estado*  nuevoEstado = malloc(sizeof(t_Estado));
 	nuevoEstado->job = job;
 	nuevoEstado->master = Master;
@@ -243,8 +418,17 @@ void agregarAtablaEstado(int job, char* nodo,int Master,int bloque,char* etapa,c
 	nuevoEstado->etapa = mstring_duplicate(etapa);
 	nuevoEstado->archivoTemporal = mstring_duplicate(archivo_temporal);
 	nuevoEstado->estado = mstring_duplicate(estado);
+	nuevoEstado->inicio = mtime_now();
+	nuevoEstado->duracion = -1;
+	nuevoEstado->nodoAlternativo = NULL;
+	nuevoEstado->bloqueAlternativo = -1;
+	nuevoEstado->bytes = 0;
+	nuevoEstado->especulativo = false;
+	nuevoEstado->copia = NULL;
+	nuevoEstado->apareo = NULL;
 	mlist_append(listaEstados,nuevoEstado);
 	log_print("Nuevo ingreso de la tabla de estado: JOB:%d|MASTER:%d|NODO:%s|BLOQUE:%d|ETAPA:%s|ARCHIVOTEMPORAL:%s|ESTADO:%s",job,Master,nodo,bloque,etapa,archivo_temporal,estado);
+	return nuevoEstado;
 
 }
 
@@ -309,7 +493,7 @@ void replanificacion(char* nodo, const char* pathArchivo,int master,int job){
 	if(Datosfile->size > 0){
 
 	bool esNodoBuscado(void* estadoTarea){
-		return string_equals_ignore_case(((t_Estado *) estadoTarea)->nodo,nodo) && ((t_Estado *) estadoTarea)->master == master && ((t_Estado *) estadoTarea)->job == job && string_equals_ignore_case(((t_Estado *) estadoTarea)->etapa,"Transformacion");
+		return string_equals_ignore_case(((t_Estado *) estadoTarea)->nodo,nodo) && ((t_Estado *) estadoTarea)->master == master && ((t_Estado *) estadoTarea)->job == job && string_equals_ignore_case(((t_Estado *) estadoTarea)->etapa,"Transformacion") && !string_equals_ignore_case(((t_Estado *) estadoTarea)->estado,"Cancelado");
 	}
 
 	mlist_t* listaFiltradaEstadosBloquesDelNodo = mlist_filter(listaEstados, (void*)esNodoBuscado);
@@ -321,6 +505,14 @@ void replanificacion(char* nodo, const char* pathArchivo,int master,int job){
 				t_Estado *  estadoActualBloque = (t_Estado*) estadoActualBloqueObtenido;
 				actualizoTablaEstado(estadoActualBloque->nodo,estadoActualBloque->block,master,job,"Error");
 
+		// Si el bloque también corre en otro nodo por especulación, esa ejecución sigue sola
+		t_Estado* copia = estadoActualBloque->copia;
+		if(copia != NULL){
+			copia->copia = NULL;
+			estadoActualBloque->copia = NULL;
+			if(string_equals_ignore_case(copia->estado, "En proceso")) continue;
+		}
+
 		bool esBloqueBuscado(void* bloqueActual){
 			if(((t_block*) bloqueActual)->copies[0].node == NULL){
 				return (string_equals_ignore_case( ((t_block*) bloqueActual)->copies[1].node, nodo ) && ((t_block*) bloqueActual)->copies[1].blockno == estadoActualBloque->block );
@@ -338,6 +530,15 @@ void replanificacion(char* nodo, const char* pathArchivo,int master,int job){
 		mlist_append(ListaDeBloquesReplanificar,bloqueEncontrado);
 	}
 
+	// Los apareos parciales del nodo contienen salidas que ahora se vuelven a transformar
+	void descartarApareo(t_Estado* estado){
+		if(estado->job == job && estado->master == master && string_equals_ignore_case(estado->nodo, nodo)
+				&& string_equals_ignore_case(estado->etapa, "Apareo")){
+			estado->estado = mstring_duplicate("Error");
+		}
+	}
+	mlist_traverse(listaEstados, descartarApareo);
+
 	mlist_t* list_to_send = mlist_create();
 
 	int posicionCargaNodoObtenida = obtenerPosicionCargaNodo(nodo);
@@ -365,11 +566,19 @@ void replanificacion(char* nodo, const char* pathArchivo,int master,int job){
 		for(i=0; i< mlist_length(list_to_send);i++){
 			void* etapaObtenida = mlist_get(list_to_send,i);
 			tEtapaTransformacion* etapa = (tEtapaTransformacion*) etapaObtenida;
-			agregarAtablaEstado(job,etapa->nodo,master,etapa->bloque,"Transformacion",etapa->archivo_etapa,"En proceso");
+			t_block* bloque = mlist_get(ListaDeBloquesReplanificar, i);
+			// Con SLOTS_POR_NODO lo replanificado espera su turno como cualquier otra transformación
+			t_Estado* estado = agregarAtablaEstado(job,etapa->nodo,master,etapa->bloque,"Transformacion",etapa->archivo_etapa,slotsPorNodo > 0 ? "En espera" : "En proceso");
+			// La copia alternativa es la del nodo que falló: sirve para especular si sigue conectado
+			t_block_copy* otra = &bloque->copies[nodoEstaEnLaCopia(bloque, 0, nodo) ? 0 : 1];
+			estado->nodoAlternativo = mstring_duplicate(otra->node);
+			estado->bloqueAlternativo = otra->blockno;
+			estado->bytes = bloque->size;
 			cargaNodo->cargaActual -= 1;
 			actualizarCargaDelNodo(etapa->nodo, job, 1, 1);
 		}
-		mandar_etapa_transformacion(list_to_send,master);
+		if(slotsPorNodo > 0) despacharTransformaciones();
+		else mandar_etapa_transformacion(list_to_send,master);
 		log_inform("Envio etapa de transformacion por efecto de la replanificacion %d",job);
 	}
 	else{
@@ -389,8 +598,7 @@ void generarEtapaTransformacionAEnviarParaCopia(int copia, t_block* bloqueARepla
 		return string_equals_ignore_case(((t_infoNodo *) datosDeUnNodo)->nodo , bloqueAReplanificar->copies[copia].node) ? true : false;
 	}
 	t_infoNodo* datosNodoAEnviar = mlist_find(listaNodosActivos, condicion);
-	char* nombreArchivoTemporal = malloc(sizeof(char)*21);
-	strcpy(nombreArchivoTemporal, generarNombreArchivoTemporalTransf(job, master, bloqueAReplanificar->copies[copia].blockno));
+	char* nombreArchivoTemporal = generarNombreArchivoTemporalTransf(job, master, bloqueAReplanificar->copies[copia].blockno);
 	tEtapaTransformacion* et = new_etapa_transformacion(bloqueAReplanificar->copies[copia].node,datosNodoAEnviar->ip,datosNodoAEnviar->puerto,bloqueAReplanificar->copies[copia].blockno,bloqueAReplanificar->size,nombreArchivoTemporal);
 	mlist_append(list_to_send,et);
 }
@@ -432,6 +640,25 @@ int obtenerPosicionCargaNodo(char * nodoAReplanificar){
 	return mlist_index(listaCargaPorNodo, condicionIndice);
 }
 
+void actualizarColaWorker(char* nodo, int cola){
+	if(cola < 0) return;
+	int posicion = obtenerPosicionCargaNodo(nodo);
+	if(posicion == -1) return;
+	t_cargaPorNodo* cargaNodo = mlist_get(listaCargaPorNodo, posicion);
+	cargaNodo->colaWorker = cola;
+	metrics_set(metrics_gauge("yama_cola_worker{nodo=\"%s\"}", nodo), cola);
+}
+
+void actualizarRendimiento(char* nodo, int bytes, int duracion){
+	if(bytes <= 0) return;
+	int posicion = obtenerPosicionCargaNodo(nodo);
+	if(posicion == -1) return;
+	t_cargaPorNodo* cargaNodo = mlist_get(listaCargaPorNodo, posicion);
+	double muestra = (double) bytes / (duracion > 0 ? duracion : 1);
+	// Promedio móvil exponencial: pesa más lo reciente sin descartar el historial
+	cargaNodo->rendimiento = cargaNodo->rendimiento == 0 ? muestra : 0.7 * cargaNodo->rendimiento + 0.3 * muestra;
+}
+
 void actualizarCargaDelNodo(char* nodoCopia, int job, int aumentarOQuitar, int cantidadAAumentar){//1 para aumentar, 0 para quitar
 	int posicionCargaNodoObtenidaCopia, posicionCargaJobObtenidoCopia;
 	bool condicionIndiceCopia1(void* cargaNodotraida){
@@ -570,7 +797,8 @@ int buscarIdJobParaMasterCaido(int socketMaster){
 	}
 	else{
 		bool jobTablaDeEstado(void* estado){
-			return ((t_Estado*) estado)->master == socketMaster && string_equals_ignore_case(((t_Estado*) estado)->estado,"En proceso");
+			return ((t_Estado*) estado)->master == socketMaster && (string_equals_ignore_case(((t_Estado*) estado)->estado,"En proceso")
+					|| string_equals_ignore_case(((t_Estado*) estado)->estado,"En espera"));
 		}
 		if(mlist_any(listaEstados,jobTablaDeEstado)){
 			t_Estado* estadoJob = mlist_find(listaEstados,jobTablaDeEstado);
@@ -634,3 +862,228 @@ void FinalizarEjecucion(int socket,int job){
 
 	}
 }
+
+static int menorDuracion(const void* duracion1, const void* duracion2){
+	return *(int*) duracion1 - *(int*) duracion2;
+}
+
+void especularTransformaciones(){
+	static mtime_t ultimaRevision = 0;
+	if(especulacionProgreso <= 0 || mtime_now() - ultimaRevision < INTERVALO_ESPECULACION) return;
+	ultimaRevision = mtime_now();
+
+	bool transformacionEnProceso(t_Estado* estado){
+		return string_equals_ignore_case(estado->etapa, "Transformacion") && string_equals_ignore_case(estado->estado, "En proceso");
+	}
+	mlist_t* enProceso = mlist_filter(listaEstados, transformacionEnProceso);
+	mlist_t* revisados = mlist_create();
+	void revisarJob(t_Estado* estado){
+		bool mismoJob(t_Estado* revisado){
+			return revisado->job == estado->job && revisado->master == estado->master;
+		}
+		if(mlist_any(revisados, mismoJob)) return;
+		mlist_append(revisados, estado);
+		especularJob(estado->job, estado->master);
+	}
+	mlist_traverse(enProceso, revisarJob);
+	mlist_destroy(revisados, NULL);
+	mlist_destroy(enProceso, NULL);
+}
+
+void especularJob(int job, int master){
+	bool transformacionDelJob(t_Estado* estado){
+		return estado->job == job && estado->master == master && string_equals_ignore_case(estado->etapa, "Transformacion");
+	}
+	mlist_t* estados = mlist_filter(listaEstados, transformacionDelJob);
+
+	// Las dos ejecuciones de un bloque especulado cuentan como un único bloque pendiente
+	int terminados = 0, pendientes = 0;
+	int duraciones[mlist_length(estados) + 1];
+	void contar(t_Estado* estado){
+		if(string_equals_ignore_case(estado->estado, "FinalizadoOK") || string_equals_ignore_case(estado->estado, "Apareado")){
+			duraciones[terminados++] = estado->duracion;
+		}
+		else if(string_equals_ignore_case(estado->estado, "En proceso") && !(estado->especulativo && estado->copia != NULL)){
+			pendientes++;
+		}
+		else if(string_equals_ignore_case(estado->estado, "En espera")){
+			pendientes++;
+		}
+	}
+	mlist_traverse(estados, contar);
+	if(terminados == 0 || pendientes == 0 || terminados * 100 < (terminados + pendientes) * especulacionProgreso){
+		mlist_destroy(estados, NULL);
+		return;
+	}
+
+	qsort(duraciones, terminados, sizeof(int), menorDuracion);
+	int posicion = (terminados * especulacionPercentil + 99) / 100 - 1;
+	int umbral = duraciones[posicion < 0 ? 0 : posicion >= terminados ? terminados - 1 : posicion];
+
+	mtime_t ahora = mtime_now();
+	mlist_t* etapas = mlist_create();
+	void especular(t_Estado* estado){
+		if(!string_equals_ignore_case(estado->estado, "En proceso") || estado->especulativo
+				|| estado->copia != NULL || estado->nodoAlternativo == NULL) return;
+		int transcurrido = ahora - estado->inicio;
+		if(transcurrido <= umbral) return;
+
+		// Si el otro nodo ya empezó su reducción local, el bloque no puede sumarse a ella
+		t_infoNodo* destino = BuscoIP_PUERTO(estado->nodoAlternativo);
+		if(destino == NULL || tieneReduccionLocal(job, master, estado->nodoAlternativo)) return;
+
+		char* archivo = generarNombreArchivoTemporalTransf(job, master, estado->bloqueAlternativo);
+		t_Estado* copia = agregarAtablaEstado(job, estado->nodoAlternativo, master, estado->bloqueAlternativo, "Transformacion", archivo, "En proceso");
+		copia->especulativo = true;
+		copia->bytes = estado->bytes;
+		copia->copia = estado;
+		estado->copia = copia;
+		actualizarCargaDelNodo(estado->nodoAlternativo, job, 1, 1);
+		mlist_append(etapas, new_etapa_transformacion(destino->nodo, destino->ip, destino->puerto, estado->bloqueAlternativo, estado->bytes, archivo));
+		log_inform("Job: %d bloque %d de %s lleva %d ms (percentil %d: %d ms), se lanza también en %s",
+				job, estado->block, estado->nodo, transcurrido, especulacionPercentil, umbral, estado->nodoAlternativo);
+		free(archivo);
+	}
+	mlist_traverse(estados, especular);
+
+	if(!mlist_empty(etapas)){
+		mandar_etapa_transformacion(etapas, master);
+	}
+	mlist_destroy(etapas, NULL);
+	mlist_destroy(estados, NULL);
+}
+
+bool tieneReduccionLocal(int job, int master, char* nodo){
+	bool esReduccionLocal(t_Estado* estado){
+		return estado->job == job && estado->master == master && string_equals_ignore_case(estado->etapa, "ReduccionLocal") && string_equals_ignore_case(estado->nodo, nodo);
+	}
+	return mlist_any(listaEstados, esReduccionLocal);
+}
+
+t_Estado* buscarEstadoTransformacion(char* nodo, int bloque, int master, int job){
+	bool esEstadoBuscado(t_Estado* estado){
+		return estado->job == job && estado->master == master && estado->block == bloque && string_equals_ignore_case(estado->nodo, nodo)
+				&& string_equals_ignore_case(estado->etapa, "Transformacion") && !string_equals_ignore_case(estado->estado, "Error");
+	}
+	return mlist_find(listaEstados, esEstadoBuscado);
+}
+
+t_Estado* resolverCopias(t_Estado* ganador){
+	ganador->duracion = mtime_now() - ganador->inicio;
+	t_Estado* perdedor = ganador->copia;
+	if(perdedor == NULL || !string_equals_ignore_case(perdedor->estado, "En proceso")) return NULL;
+
+	// Gana la primera ejecución que termina; a la otra se le avisa a Master para que la cancele
+	perdedor->estado = mstring_duplicate("Cancelado");
+	log_print("Actualizacion en la tabla de estado: JOB:%d|MASTER:%d|NODO:%s|BLOQUE:%d|ETAPA:%s|ARCHIVOTEMPORAL:%s|ESTADO:%s",perdedor->job,perdedor->master,perdedor->nodo,perdedor->block,perdedor->etapa,perdedor->archivoTemporal,perdedor->estado);
+	t_packet packetCancelar = protocol_packet(OP_CANCELAR_TRANSFORMACION, serial_pack("si", perdedor->nodo, perdedor->block));
+	protocol_send_packet(packetCancelar, perdedor->master);
+	serial_destroy(packetCancelar.content);
+	return perdedor;
+}
+
+void despacharTransformaciones(){
+	if(slotsPorNodo <= 0) return;
+	bool enEspera(t_Estado* estado){
+		return string_equals_ignore_case(estado->estado, "En espera");
+	}
+	if(!mlist_any(listaEstados, enEspera)){
+		metrics_set(metrics_gauge("yama_transformaciones_en_espera"), 0);
+		return;
+	}
+
+	// Foto de la ocupación actual: tareas en curso por nodo y por job, y la cola de cada job
+	mlist_t* ocupaciones = mlist_create();
+	mlist_t* colas = mlist_create();
+	t_ocupacionNodo* ocupacionDe(char* nodo){
+		bool esNodo(t_ocupacionNodo* ocupacion){
+			return string_equals_ignore_case(ocupacion->nodo, nodo);
+		}
+		t_ocupacionNodo* ocupacion = mlist_find(ocupaciones, esNodo);
+		if(ocupacion == NULL){
+			ocupacion = malloc(sizeof(t_ocupacionNodo));
+			ocupacion->nodo = nodo;
+			ocupacion->enCurso = 0;
+			mlist_append(ocupaciones, ocupacion);
+		}
+		return ocupacion;
+	}
+	t_colaJob* colaDe(t_Estado* estado){
+		bool esJob(t_colaJob* cola){
+			return cola->job == estado->job && cola->master == estado->master;
+		}
+		t_colaJob* cola = mlist_find(colas, esJob);
+		if(cola == NULL){
+			cola = malloc(sizeof(t_colaJob));
+			cola->job = estado->job;
+			cola->master = estado->master;
+			cola->peso = pesoJob(estado->job, estado->master);
+			cola->enCurso = 0;
+			cola->espera = mlist_create();
+			cola->liberadas = mlist_create();
+			mlist_append(colas, cola);
+		}
+		return cola;
+	}
+	void contar(t_Estado* estado){
+		if(string_equals_ignore_case(estado->estado, "En proceso")){
+			ocupacionDe(estado->nodo)->enCurso++;
+			colaDe(estado)->enCurso++;
+		}
+		else if(enEspera(estado)){
+			mlist_append(colaDe(estado)->espera, estado);
+		}
+	}
+	mlist_traverse(listaEstados, contar);
+
+	bool hayLugar(t_Estado* estado){
+		return BuscoIP_PUERTO(estado->nodo) != NULL && ocupacionDe(estado->nodo)->enCurso < slotsPorNodo;
+	}
+	while(true){
+		// Avanza el job con menos tareas en curso en proporción a su peso (a igual cuota, el más antiguo)
+		t_colaJob* elegida = NULL;
+		t_Estado* siguiente = NULL;
+		void comparar(t_colaJob* cola){
+			if(elegida != NULL && cola->enCurso * elegida->peso >= elegida->enCurso * cola->peso) return;
+			t_Estado* estado = mlist_find(cola->espera, hayLugar);
+			if(estado == NULL) return;
+			elegida = cola;
+			siguiente = estado;
+		}
+		mlist_traverse(colas, comparar);
+		if(elegida == NULL) break;
+
+		bool esSiguiente(t_Estado* estado){
+			return estado == siguiente;
+		}
+		mlist_remove(elegida->espera, esSiguiente, NULL);
+		siguiente->estado = mstring_duplicate("En proceso");
+		siguiente->inicio = mtime_now();
+		ocupacionDe(siguiente->nodo)->enCurso++;
+		elegida->enCurso++;
+		mlist_append(elegida->liberadas, siguiente);
+	}
+
+	int enEsperaTotal = 0;
+	void enviar(t_colaJob* cola){
+		enEsperaTotal += mlist_length(cola->espera);
+		if(!mlist_empty(cola->liberadas)){
+			tEtapaTransformacion* etapa(t_Estado* estado){
+				t_infoNodo* nodo = BuscoIP_PUERTO(estado->nodo);
+				return new_etapa_transformacion(nodo->nodo, nodo->ip, nodo->puerto, estado->block, estado->bytes, estado->archivoTemporal);
+			}
+			mlist_t* etapas = mlist_map(cola->liberadas, etapa);
+			mandar_etapa_transformacion(etapas, cola->master);
+			log_inform("Job: %d se liberan %d transformaciones (%d en curso, peso %d, %d en espera)",
+					cola->job, mlist_length(etapas), cola->enCurso, cola->peso, mlist_length(cola->espera));
+			mlist_destroy(etapas, NULL);
+		}
+		mlist_destroy(cola->espera, NULL);
+		mlist_destroy(cola->liberadas, NULL);
+		free(cola);
+	}
+	mlist_traverse(colas, enviar);
+	metrics_set(metrics_gauge("yama_transformaciones_en_espera"), enEsperaTotal);
+	mlist_destroy(colas, NULL);
+	mlist_destroy(ocupaciones, free);
+}
@@ -4,6 +4,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <pthread.h>
 
 #include <log.h>
@@ -14,6 +15,9 @@
 #include <config.h>
 #include "struct.h"
 #include <yfile.h>
+#include <data.h>
+#include <heap.h>
+#include <mstring.h>
 #include <commons/collections/list.h>
 #include <unistd.h>
 
@@ -21,17 +25,24 @@
 
 
 
-void planificar(t_workerPlanificacion[], int, mlist_t*);
+#define INTERVALO_ESPECULACION 1000 // Milisegundos entre revisiones de transformaciones atrasadas
+
+bool planificar(t_workerPlanificacion[], int, mlist_t*);
+bool planificarPorCosto(t_workerPlanificacion[], int, mlist_t*);
 void mostrar_configuracion();
-void llenarArrayPlanificador(t_workerPlanificacion[],int,int *);
-int Disponibilidad(int, char*);
-void verificarCondicion(int, int *,t_workerPlanificacion[],int*,mlist_t*);
+void llenarArrayPlanificador(t_workerPlanificacion[],int,int,int *);
+int availabilityClock();
+int Disponibilidad(int, int, char*);
+t_block** bloquesComoArreglo(mlist_t*, int*);
+int* indicesDeCopias(t_workerPlanificacion[], int, t_block**, int);
 respuestaOperacionTranf* serial_unpackRespuestaOperacion(t_serial *);
 respuestaOperacion* serial_unpackrespuestaOperacion(t_serial *);
 bool NodoConCopia_is_active(char*);
 void destruirlista(void*);
 void abortarJob(int, int, int);
 int obtenerPosicionCargaNodo(char *);
+void actualizarColaWorker(char*, int);
+void actualizarRendimiento(char*, int, int);
 void actualizarCargaDelNodo(char*, int, int, int);
 int existeElJobEnLaCopia(int, mlist_t *);
 bool nodoEstaEnLaCopia(t_block*, int, char*);
@@ -41,14 +52,22 @@ void eliminarCargaJobDelNodo(int , mlist_t *);
 int cargaActual(char*);
 void replanificacion(char*, const char*,int,int);
 t_pedidoTrans* serial_unpackPedido(t_serial*);
+void registrarJob(t_pedidoTrans*, int);
+const char* extensionJob(int, int);
+void quitarJobs(int);
+int pesoJob(int, int);
+void despacharTransformaciones();
 void eliminarEstadosMultiples(int,int, char*);
 void finalizarJobGlobalEnTablaEstado(int,int, char*);
 void finalizarJobGlobal(int, int, int, char*);
 void eliminarCargasReduccionesLocales(char*,int,int);
 int obtenerHistorico(char *);
-void avanzoPosicion(int *,int,t_workerPlanificacion[]);
-void asignoBloque(t_workerPlanificacion[], int *,int*,int);
 void avisarErrorMaster(int, int , int );
+void especularTransformaciones();
+void especularJob(int, int);
+bool tieneReduccionLocal(int, int, char*);
+t_Estado* buscarEstadoTransformacion(char*, int, int, int);
+t_Estado* resolverCopias(t_Estado*);
 int buscarIdJobParaMasterCaido(int);
 mlist_t* buscarSocketsActivos();
 void FinalizarEjecucion(int,int);
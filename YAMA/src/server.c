@@ -2,6 +2,7 @@
 
 #include <config.h>
 #include <log.h>
+#include <metrics.h>
 #include <mstring.h>
 #include <process.h>
 #include <protocol.h>
@@ -12,6 +13,7 @@
 #include <stdlib.h>
 #include <struct.h>
 #include <thread.h>
+#include <trace.h>
 #include "funcionesYAMA.h"
 #include "YAMA.h"
 #include "mstring.h"
@@ -28,24 +30,24 @@ void listen_to_master() {
 	socket_set_add(yama.fs_socket,&sockets);
 
 	while(true) {
-		t_fdset selected = socket_select(sockets);
+		// Con especulación el select despierta aunque no llegue nada, para revisar los atrasados
+		t_fdset selected = especulacionProgreso > 0 ? socket_select_timeout(sockets, INTERVALO_ESPECULACION) : socket_select(sockets);
 
 		for(t_socket sock = 3; sock <= sockets.max; sock++) {
 			if(!socket_set_contains(sock, &selected)) continue;
 			if(sock == sv_sock) {
 				t_socket cli_sock = socket_accept(sv_sock);
-				t_packet packet = protocol_receive_packet(cli_sock);
-				if(packet.operation == OP_HANDSHAKE && packet.sender == PROC_MASTER) {
+				if(protocol_receive_handshake(cli_sock) == PROC_MASTER) {
 					socket_set_add(cli_sock, &sockets);
 					log_inform("Conectado proceso Master por socket %i", cli_sock);
 					log_inform("IdCliente otorgado: %d ",numeroJob);
-					t_packet packetID = protocol_packet(OP_IDJOB, serial_pack("i",numeroJob));
+					t_packet packetID = protocol_packet(OP_IDJOB, serial_pack("ii",numeroJob,slotsPorNodo));
 					protocol_send_packet(packetID,cli_sock);
 					numeroJob++;
 				} else {
+					log_inform("Se rechaza conexión en el socket %d: apretón de manos inválido", cli_sock);
 					socket_close(cli_sock);
 				}
-				serial_destroy(packet.content);
 			}
 			else if(sock == yama.fs_socket){
 				FinalizarEjecucion(-1,-1);
@@ -58,19 +60,27 @@ void listen_to_master() {
 					if(idJob > 0){
 						eliminarEstadosMultiples(sock,idJob, "Error");
 					}
+					quitarJobs(sock);
 					socket_close(sock);
 					socket_set_remove(sock, &sockets);
 					continue;
 				}
 
+				// Todo lo que se haga por este mensaje (incluso lo que se pida al FS) va a la traza del job
+				trace_set(packetOperacion.trace);
+				uint64_t inicioMensaje = trace_now();
 				switch(packetOperacion.operation) {
 				case OP_INIT_JOB:
 					{
 						t_pedidoTrans* pedidoInicio = serial_unpackPedido(packetOperacion.content);
-						log_inform("Inicio de job nuevo :%d",pedidoInicio->idJOB);
+						log_inform("Inicio de job nuevo :%d%s",pedidoInicio->idJOB,
+								pedidoInicio->combinar ? " (con combinador)" : "");
+						registrarJob(pedidoInicio, sock);
 						t_serial* file_serial = serial_pack("s",pedidoInicio->file);
+						uint64_t inicioInfo = trace_now();
 						requerirInformacionFilesystem(file_serial);
 						t_yfile* Datosfile = reciboInformacionSolicitada(pedidoInicio->idJOB,sock);
+						trace_span("info_archivo", inicioInfo, trace_now(), "%s", pedidoInicio->file);
 						if(Datosfile->size>0){
 							int tamaniolistaNodos = mlist_length(listaNodosActivos);
 							if(tamaniolistaNodos == 0){
@@ -82,8 +92,16 @@ void listen_to_master() {
 								completarPrimeraVez();
 								t_workerPlanificacion planificador[tamaniolistaNodos];
 								entreAPlanificar = true;
+								uint64_t inicioRetardo = trace_now();
 								thread_sleep(retardoPlanificacion);
-								planificar(planificador, tamaniolistaNodos,Datosfile->blocks);
+								trace_span("retardo_planificacion", inicioRetardo, trace_now(), "%d ms", retardoPlanificacion);
+								// Se mide el algoritmo, sin el retardo configurado
+								uint64_t inicioPlanificacion = metrics_now();
+								uint64_t inicioTraza = trace_now();
+								bool planificado = planificar(planificador, tamaniolistaNodos,Datosfile->blocks);
+								metrics_since(metrics_histogram("yama_planificacion_us"), inicioPlanificacion);
+								trace_span("planificacion", inicioTraza, trace_now(), "%s: %d bloques en %d nodos",
+										algoritmoBalanceo, mlist_length(Datosfile->blocks), tamaniolistaNodos);
 								if(recibiSenial){
 									 config_reload();
 									 retardoPlanificacion = atoi(config_get("RETARDO_PLANIFICACION"));
@@ -92,8 +110,13 @@ void listen_to_master() {
 									 recibiSenial = false;
 								}
 								entreAPlanificar = false;
-								agregarCargaNodoSegunLoPlanificado(pedidoInicio->idJOB, planificador, tamaniolistaNodos);
-								enviarEtapa_transformacion_Master(pedidoInicio->idJOB,tamaniolistaNodos,planificador,Datosfile->blocks,sock);
+								if(planificado){
+									agregarCargaNodoSegunLoPlanificado(pedidoInicio->idJOB, planificador, tamaniolistaNodos);
+									enviarEtapa_transformacion_Master(pedidoInicio->idJOB,tamaniolistaNodos,planificador,Datosfile->blocks,sock);
+								}else{
+									log_report("Job: %d abortado",pedidoInicio->idJOB);
+									avisarErrorMaster(pedidoInicio->idJOB, sock,ERROR_PLANIFICACION);
+								}
 							}
 
 						}
@@ -101,11 +124,20 @@ void listen_to_master() {
 					break;
 				case OP_TRANSFORMACION_LISTA :
 					{respuestaOperacionTranf* finalizoOperacion = serial_unpackRespuestaOperacion(packetOperacion.content);
+					actualizarColaWorker(finalizoOperacion->nodo, finalizoOperacion->colaWorker);
 
-					if(finalizoOperacion->response == -1){
+					t_Estado* estadoBloque = buscarEstadoTransformacion(finalizoOperacion->nodo,finalizoOperacion->bloque,sock,finalizoOperacion->idJOB);
+					if(estadoBloque != NULL && string_equals_ignore_case(estadoBloque->estado, "Cancelado")){
+						log_inform("Se descarta el resultado del bloque %d en %s: ya terminó la otra copia",finalizoOperacion->bloque,finalizoOperacion->nodo);
+					}
+					else if(finalizoOperacion->response == -1){
 						entreAPlanificar = true;
 						thread_sleep(retardoPlanificacion);
+						uint64_t inicioReplanificacion = metrics_now();
+						uint64_t inicioTraza = trace_now();
 						replanificacion(finalizoOperacion->nodo,finalizoOperacion->file,sock,finalizoOperacion->idJOB);
+						metrics_since(metrics_histogram("yama_replanificacion_us"), inicioReplanificacion);
+						trace_span("replanificacion", inicioTraza, trace_now(), "caída de %s", finalizoOperacion->nodo);
 						if(recibiSenial){
 							 config_reload();
 							 retardoPlanificacion = atoi(config_get("RETARDO_PLANIFICACION"));
@@ -122,12 +154,13 @@ void listen_to_master() {
 						}
 						else{
 							log_inform("Transformacion terminada para :%d bloque: %d",finalizoOperacion->idJOB,finalizoOperacion->bloque);
+							actualizarRendimiento(finalizoOperacion->nodo, finalizoOperacion->bytes, finalizoOperacion->duracion);
 							actualizoTablaEstado(finalizoOperacion->nodo,finalizoOperacion->bloque,sock,finalizoOperacion->idJOB,"FinalizadoOK");
-							if(verificoFinalizacionTransformacion(finalizoOperacion->nodo,sock,finalizoOperacion->idJOB)){
-								t_infoNodo* IP_PUERTOnodo = BuscoIP_PUERTO(finalizoOperacion->nodo);
-								mlist_t* archivosTemporales_Transf = BuscoArchivosTemporales(finalizoOperacion->nodo,sock,finalizoOperacion->idJOB);
-								char* temporal_local = generarNombreTemporal_local(finalizoOperacion->nodo,sock,finalizoOperacion->idJOB);
-								mandarEtapaReduccionLocal(finalizoOperacion->idJOB,sock,finalizoOperacion->nodo,IP_PUERTOnodo,archivosTemporales_Transf,temporal_local);
+							t_Estado* cancelado = estadoBloque != NULL ? resolverCopias(estadoBloque) : NULL;
+							verificarReduccionLocal(finalizoOperacion->nodo,sock,finalizoOperacion->idJOB);
+							if(cancelado != NULL){
+								// El nodo de la copia cancelada puede no tener otra cosa que esperar
+								verificarReduccionLocal(cancelado->nodo,sock,finalizoOperacion->idJOB);
 							}
 						}
 					}
@@ -150,6 +183,13 @@ void listen_to_master() {
 					}
 					}
 				break;
+				case OP_APAREO_LISTO:
+					{respuestaOperacion* finalizoApareo = serial_unpackrespuestaOperacion(packetOperacion.content);
+					log_inform("Apareo parcial terminado para :%d nodo: %s (%d)",finalizoApareo->idJOB,finalizoApareo->nodo,finalizoApareo->response);
+					terminarApareo(finalizoApareo->nodo,sock,finalizoApareo->idJOB,finalizoApareo->response == RESPONSE_OK);
+					verificarReduccionLocal(finalizoApareo->nodo,sock,finalizoApareo->idJOB);
+					}
+				break;
 				case OP_REDUCCION_GLOBAL_LISTA:
 					{respuestaOperacion* finalizoRG = serial_unpackrespuestaOperacion(packetOperacion.content);
 
@@ -157,6 +197,10 @@ void listen_to_master() {
 						finalizarJobGlobal(finalizoRG->idJOB,sock,ERROR_REDUCCION_GLOBAL,"Error");
 
 					}
+					else if(terminarReduccionGlobalParcial(finalizoRG->nodo,sock,finalizoRG->idJOB)){
+						log_inform("Reduccion global parcial terminada para job: %d nodo: %s",finalizoRG->idJOB,finalizoRG->nodo);
+						avanzarReduccionGlobal(sock,finalizoRG->idJOB);
+					}
 					else{
 						log_inform("Etapa de reduccion global terminada para job: %d",finalizoRG->idJOB);
 						actualizoTablaEstado(finalizoRG->nodo,-2,sock,finalizoRG->idJOB,"FinalizadoOK");
@@ -181,8 +225,13 @@ void listen_to_master() {
 				break;
 
 				}
+				// YAMA atiende de a un mensaje: estos tramos muestran cuánto espera cada job al resto
+				trace_span("yama_mensaje", inicioMensaje, trace_now(), "operación %d", packetOperacion.operation);
+				trace_set(0);
 			}
 		}
+		especularTransformaciones();
+		despacharTransformaciones();
 	}
 }
 
@@ -220,6 +269,8 @@ void crearCargaPorNodo(char* nombreNodo){
  cargaPorNodo->nodo = strcpy(cargaPorNodo->nodo, nombreNodo);
  cargaPorNodo->cargaActual = 0;
  cargaPorNodo->cargaHistorica = 0;
+ cargaPorNodo->colaWorker = 0;
+ cargaPorNodo->rendimiento = 0;
  cargaPorNodo->cargaPorJob = mlist_create();
  mlist_append(listaCargaPorNodo, cargaPorNodo);
 }
@@ -252,58 +303,143 @@ void agregarCargaNodoSegunLoPlanificado(int job, t_workerPlanificacion planifica
 
 void enviarEtapa_transformacion_Master(int job, int tamaniolistaNodos,t_workerPlanificacion planificador[],mlist_t* listabloques,int sock){
 	mlist_t* lista = mlist_create();
-	int i, j = 0;
-	int nroIndex;
+	int i;
+	// Los bloques se ubican por índice en un arreglo en lugar de buscarlos en la lista uno por uno
+	int cantidadBloques, maximoIndice = -1;
+	t_block** bloques = bloquesComoArreglo(listabloques, &cantidadBloques);
+	for(i = 0; i < cantidadBloques; i++){
+		if(bloques[i]->index > maximoIndice) maximoIndice = bloques[i]->index;
+	}
+	t_block** bloquePorIndice = calloc(maximoIndice + 1, sizeof(t_block*));
+	for(i = 0; i < cantidadBloques; i++){
+		bloquePorIndice[bloques[i]->index] = bloques[i];
+	}
+
 	for(i = 0; i < tamaniolistaNodos; i++){
-		for(j = 0; j < mlist_length(planificador[i].bloque); j++){
-			void* nroIndexOBtenido = mlist_get(planificador[i].bloque, j);
-			nroIndex = (int)nroIndexOBtenido;
-			t_infoNodo* datosNodoAEnviar = mlist_get(listaNodosActivos, i);
-			bool condition(void* datosDeUnBloque){
-				return ((t_block *) datosDeUnBloque)->index == nroIndex ? true : false;
+		t_infoNodo* datosNodoAEnviar = mlist_get(listaNodosActivos, i);
+		void enviarBloque(void* nroIndexOBtenido){
+			t_block* datosDeUnBloque = bloquePorIndice[(intptr_t) nroIndexOBtenido];
+			int copia = datosDeUnBloque->copies[0].node != NULL
+					&& !strcmp(datosDeUnBloque->copies[0].node, datosNodoAEnviar->nodo) ? 0 : 1;
+			int nroBloque = datosDeUnBloque->copies[copia].blockno;
+
+			char* nombreArchivoTemporal = generarNombreArchivoTemporalTransf(job,sock, nroBloque);
+
+			// Con SLOTS_POR_NODO la tarea queda encolada hasta que el reparto entre jobs le dé lugar
+			if(slotsPorNodo <= 0){
+				tEtapaTransformacion* et = new_etapa_transformacion(datosNodoAEnviar->nodo,datosNodoAEnviar->ip,datosNodoAEnviar->puerto,nroBloque, datosDeUnBloque->size,nombreArchivoTemporal); //ROMPE EN ESTA funcion
+				mlist_append(lista,et);
 			}
-			void* datosDeUnBloqueObtenido = mlist_find(listabloques,(void*) condition);
-			t_block* datosDeUnBloque = (t_block*)datosDeUnBloqueObtenido;
-			int nroBloque;
-			if(datosDeUnBloque->copies[0].node != NULL){
-				if(!strcmp(datosDeUnBloque->copies[0].node, datosNodoAEnviar->nodo)){
-					nroBloque = datosDeUnBloque->copies[0].blockno;
-				} else{
-					nroBloque = datosDeUnBloque->copies[1].blockno;
-				}
-			}else{
-				nroBloque = datosDeUnBloque->copies[1].blockno;
+			t_Estado* estado = agregarAtablaEstado(job,datosNodoAEnviar->nodo,sock,nroBloque,"Transformacion",nombreArchivoTemporal,slotsPorNodo > 0 ? "En espera" : "En proceso");
+			// La otra copia permite lanzar el bloque en otro nodo si este se atrasa
+			t_block_copy* otra = &datosDeUnBloque->copies[1 - copia];
+			if(otra->node != NULL && strcmp(otra->node, datosNodoAEnviar->nodo)){
+				estado->nodoAlternativo = mstring_duplicate(otra->node);
+				estado->bloqueAlternativo = otra->blockno;
 			}
-
-			char* nombreArchivoTemporal = malloc(sizeof(char)*21);
-
-			strcpy(nombreArchivoTemporal, generarNombreArchivoTemporalTransf(job,sock, nroBloque));
-
-			tEtapaTransformacion* et = new_etapa_transformacion(datosNodoAEnviar->nodo,datosNodoAEnviar->ip,datosNodoAEnviar->puerto,nroBloque, datosDeUnBloque->size,nombreArchivoTemporal); //ROMPE EN ESTA funcion
-			mlist_append(lista,et);
-			agregarAtablaEstado(job,datosNodoAEnviar->nodo,sock,nroBloque,"Transformacion",nombreArchivoTemporal,"En proceso");
+			estado->bytes = datosDeUnBloque->size;
 		}
+		mlist_traverse(planificador[i].bloque, enviarBloque);
 	}
-	mandar_etapa_transformacion(lista,sock);
+	free(bloquePorIndice);
+	free(bloques);
+	if(slotsPorNodo > 0) despacharTransformaciones();
+	else mandar_etapa_transformacion(lista,sock);
 	log_inform("Etapa de transformacion iniciada para job: %d",job);
 
 }
 
 bool verificoFinalizacionTransformacion(char* nodo,int socket,int job){
 	bool esNodoBuscado(void* estadoTarea){
-		return string_equals_ignore_case(((t_Estado *) estadoTarea)->nodo,nodo) && ((t_Estado *) estadoTarea)->master == socket && !string_equals_ignore_case(((t_Estado *) estadoTarea)->estado, "Error") && ((t_Estado *) estadoTarea)->job == job;
+		return string_equals_ignore_case(((t_Estado *) estadoTarea)->nodo,nodo) && ((t_Estado *) estadoTarea)->master == socket && !string_equals_ignore_case(((t_Estado *) estadoTarea)->estado, "Error") && !string_equals_ignore_case(((t_Estado *) estadoTarea)->estado, "Cancelado") && ((t_Estado *) estadoTarea)->job == job;
 	}
 
 	mlist_t* listaFiltradaDelNodo = mlist_filter(listaEstados, (void*)esNodoBuscado);
 	bool FinalizacionDeTransf_Nodo(void* estadoTarea){
-			  	return string_equals_ignore_case(((t_Estado *) estadoTarea)->estado,"FinalizadoOK");
+			  	return string_equals_ignore_case(((t_Estado *) estadoTarea)->estado,"FinalizadoOK")
+			  			|| string_equals_ignore_case(((t_Estado *) estadoTarea)->estado,"Apareado");
 	}
-	bool terminarontodos = mlist_all(listaFiltradaDelNodo, (void*) FinalizacionDeTransf_Nodo);
+	bool terminarontodos = !mlist_empty(listaFiltradaDelNodo) && mlist_all(listaFiltradaDelNodo, (void*) FinalizacionDeTransf_Nodo);
 	mlist_destroy(listaFiltradaDelNodo,NULL);
 	return terminarontodos;
 
 }
 
+void verificarReduccionLocal(char* nodo, int sock, int job){
+	if(verificoFinalizacionTransformacion(nodo,sock,job)){
+		t_infoNodo* IP_PUERTOnodo = BuscoIP_PUERTO(nodo);
+		mlist_t* archivosTemporales_Transf = BuscoArchivosTemporales(nodo,sock,job);
+		char* temporal_local = generarNombreTemporal_local(nodo,sock,job);
+		mandarEtapaReduccionLocal(job,sock,nodo,IP_PUERTOnodo,archivosTemporales_Transf,temporal_local);
+	}
+	else{
+		aparearParcial(nodo,sock,job);
+	}
+}
+
+void aparearParcial(char* nodo, int master, int job){
+	if(apareoParcial <= 0) return;
+	bool esApareoDelNodo(t_Estado* estado){
+		return estado->job == job && estado->master == master && string_equals_ignore_case(estado->nodo, nodo) && string_equals_ignore_case(estado->etapa, "Apareo");
+	}
+	bool apareoPendienteOFallido(t_Estado* estado){
+		return esApareoDelNodo(estado) && !string_equals_ignore_case(estado->estado, "FinalizadoOK");
+	}
+	// Un apareo por nodo a la vez; si uno falló, el resto queda para la reducción local
+	if(mlist_any(listaEstados, apareoPendienteOFallido)) return;
+
+	bool transformacionTerminada(t_Estado* estado){
+		return estado->job == job && estado->master == master && string_equals_ignore_case(estado->nodo, nodo)
+				&& string_equals_ignore_case(estado->etapa, "Transformacion") && string_equals_ignore_case(estado->estado, "FinalizadoOK");
+	}
+	mlist_t* terminadas = mlist_filter(listaEstados, transformacionTerminada);
+	if(mlist_length(terminadas) < apareoParcial){
+		mlist_destroy(terminadas, NULL);
+		return;
+	}
+
+	char* archivo = mstring_create("/tmp/J%dMaster%d-%s-a%d%s", job, master, nodo, mlist_count(listaEstados, esApareoDelNodo), extensionJob(job, master));
+	t_Estado* apareo = agregarAtablaEstado(job,nodo,master,-4,"Apareo",archivo,"En proceso");
+	void consumir(t_Estado* estado){
+		estado->estado = mstring_duplicate("Apareado");
+		estado->apareo = apareo;
+	}
+	mlist_traverse(terminadas, consumir);
+	char* getArchivoTemporal(t_Estado* estado){
+		return estado->archivoTemporal;
+	}
+	mlist_t* archivos = mlist_map(terminadas, getArchivoTemporal);
+
+	tEtapaReduccionLocal* etapa = new_etapa_rl(nodo,BuscoIP_PUERTO(nodo)->ip,BuscoIP_PUERTO(nodo)->puerto,archivos,archivo);
+	mandar_etapa_apareo(etapa,master);
+	log_inform("Apareo parcial de %d salidas iniciado para job: %d|| Nodo: %s",mlist_length(archivos),job,nodo);
+
+	mlist_destroy(archivos, NULL);
+	mlist_destroy(terminadas, NULL);
+	free(archivo);
+}
+
+void terminarApareo(char* nodo, int master, int job, bool ok){
+	bool apareoEnProceso(t_Estado* estado){
+		return estado->job == job && estado->master == master && string_equals_ignore_case(estado->nodo, nodo)
+				&& string_equals_ignore_case(estado->etapa, "Apareo") && string_equals_ignore_case(estado->estado, "En proceso");
+	}
+	t_Estado* apareo = mlist_find(listaEstados, apareoEnProceso);
+	if(apareo == NULL) return;
+	apareo->estado = mstring_duplicate(ok ? "FinalizadoOK" : "Error");
+	log_print("Actualizacion en la tabla de estado: JOB:%d|MASTER:%d|NODO:%s|BLOQUE:%d|ETAPA:%s|ARCHIVOTEMPORAL:%s|ESTADO:%s",job,master,nodo,apareo->block,apareo->etapa,apareo->archivoTemporal,apareo->estado);
+	if(ok) return;
+
+	// Las salidas siguen en el Worker: vuelven a quedar para la reducción local
+	void restaurar(t_Estado* estado){
+		if(estado->apareo == apareo && string_equals_ignore_case(estado->estado, "Apareado")){
+			estado->estado = mstring_duplicate("FinalizadoOK");
+			estado->apareo = NULL;
+		}
+	}
+	mlist_traverse(listaEstados, restaurar);
+}
+
 void mandarEtapaReduccionLocal(int job, int socket,char* nodo,t_infoNodo* nodo_worker,mlist_t* archivos_transf,char* archivoTemporal_local){
 	tEtapaReduccionLocal* etapaRL = new_etapa_rl(nodo,nodo_worker->ip,nodo_worker->puerto,archivos_transf,archivoTemporal_local);
 	agregarAtablaEstado(job,nodo,socket,-1,"ReduccionLocal",archivoTemporal_local,"En proceso");
@@ -343,9 +479,7 @@ mlist_t* BuscoArchivosTemporales(char* nodo,int socket,int job){
 
 
 char* generarNombreTemporal_local(char* nodo,int master,int job){
-	char* nombreArchivoTemporal = malloc(sizeof(char)*21);
-	sprintf(nombreArchivoTemporal,"/tmp/J%dMaster%d-%s",job,master,nodo);
-	return nombreArchivoTemporal;
+	return mstring_create("/tmp/J%dMaster%d-%s%s",job,master,nodo,extensionJob(job,master));
 
 }
 
@@ -358,13 +492,15 @@ bool verificoFinalizacionRl(int job, int master){
 				  			((t_Estado *) estadoTarea)->job == job
 							&& ( string_equals_ignore_case(((t_Estado *) estadoTarea)->etapa, "ReduccionLocal")
 							|| string_equals_ignore_case(((t_Estado *) estadoTarea)->etapa, "Transformacion"))
-							&& !string_equals_ignore_case(((t_Estado *) estadoTarea)->estado,"Error");
+							&& !string_equals_ignore_case(((t_Estado *) estadoTarea)->estado,"Error")
+							&& !string_equals_ignore_case(((t_Estado *) estadoTarea)->estado,"Cancelado");
 		}
 
 		mlist_t* listaFiltradaDelNodo = mlist_filter(listaEstados, (void*)esJobBuscado);
 
 		bool FinalizacionDeRl_Job(void* estadoTarea){
-					  	return string_equals_ignore_case(((t_Estado *) estadoTarea)->estado,"FinalizadoOK");
+					  	return string_equals_ignore_case(((t_Estado *) estadoTarea)->estado,"FinalizadoOK")
+					  			|| string_equals_ignore_case(((t_Estado *) estadoTarea)->estado,"Apareado");
 		}
 
 			return mlist_all(listaFiltradaDelNodo, (void*) FinalizacionDeRl_Job);
@@ -372,10 +508,19 @@ bool verificoFinalizacionRl(int job, int master){
 }
 
 void mandarEtapaReduccionGL(int master,int job){
-	mlist_t* listaRG = mlist_create();
+	if(gradoReduccionGlobal > 1){
+		avanzarReduccionGlobal(master,job);
+		return;
+	}
 	mlist_t* NodosRL = BuscoNodos(master,job);
+	enviarReduccionGlobal(master,job,NodosRL,generarArchivoRG(master,job),"ReduccionGlobal",-2);
+	log_inform("Etapa de reduccion global iniciada para job: %d",job);
+
+}
+
+t_Estado* enviarReduccionGlobal(int master, int job, mlist_t* NodosRL, char* nombreRG, char* etapa, int bloque){
+	mlist_t* listaRG = mlist_create();
 	char* nodo = seleccionarEncargado(NodosRL, job);
-	char* nombreRG = generarArchivoRG(master,job);
 	int i = 0;
 	for(i=0; i < mlist_length(NodosRL); i++){
 		void* unNodo_sendObtenido	= mlist_get(NodosRL,i);
@@ -390,10 +535,67 @@ void mandarEtapaReduccionGL(int master,int job){
 			mlist_append(listaRG,etapaRG);
 		}
 	}
-	agregarAtablaEstado(job,nodo,master,-2,"ReduccionGlobal",nombreRG,"En proceso");
+	t_Estado* estado = agregarAtablaEstado(job,nodo,master,bloque,etapa,nombreRG,"En proceso");
 	mandar_etapa_rg(listaRG,master);
-	log_inform("Etapa de reduccion global iniciada para job: %d",job);
+	return estado;
+}
 
+void avanzarReduccionGlobal(int master, int job){
+	// Resultados listos para reducirse: reducciones locales y reducciones parciales no consumidas
+	bool disponible(t_Estado* estado){
+		return estado->job == job && estado->master == master && string_equals_ignore_case(estado->estado, "FinalizadoOK")
+				&& (string_equals_ignore_case(estado->etapa, "ReduccionLocal") || string_equals_ignore_case(estado->etapa, "ReduccionGlobalParcial"));
+	}
+	bool parcial(t_Estado* estado){
+		return estado->job == job && estado->master == master && string_equals_ignore_case(estado->etapa, "ReduccionGlobalParcial");
+	}
+	bool parcialEnProceso(t_Estado* estado){
+		return parcial(estado) && string_equals_ignore_case(estado->estado, "En proceso");
+	}
+	mlist_t* disponibles = mlist_filter(listaEstados, disponible);
+
+	t_nodotemporal* consumir(t_Estado* estado){
+		estado->estado = mstring_duplicate("Apareado");
+		t_nodotemporal* info_enviar_toRG = malloc(sizeof(t_nodotemporal));
+		info_enviar_toRG->nodo = estado->nodo;
+		info_enviar_toRG->archivoTemporal = estado->archivoTemporal;
+		return info_enviar_toRG;
+	}
+
+	// Cuando ya no queda nada en curso y entran en un grupo, va la reducción final
+	if(!mlist_any(listaEstados, parcialEnProceso) && mlist_length(disponibles) <= gradoReduccionGlobal){
+		mlist_t* grupo = mlist_map(disponibles, consumir);
+		enviarReduccionGlobal(master,job,grupo,generarArchivoRG(master,job),"ReduccionGlobal",-2);
+		log_inform("Etapa de reduccion global iniciada para job: %d (%d resultados)",job,mlist_length(grupo));
+		mlist_destroy(grupo, free);
+	}
+	else{
+		// Cada grupo de k resultados se reduce en paralelo en uno de sus nodos
+		while(mlist_length(disponibles) >= gradoReduccionGlobal){
+			mlist_t* grupo = mlist_create();
+			for(int i = 0; i < gradoReduccionGlobal; i++){
+				mlist_append(grupo, consumir(mlist_pop(disponibles, 0)));
+			}
+			char* nombre = mstring_create("/tmp/J%dMaster%d-rg%d%s", job, master, mlist_count(listaEstados, parcial), extensionJob(job, master));
+			t_Estado* estado = enviarReduccionGlobal(master,job,grupo,nombre,"ReduccionGlobalParcial",-5);
+			log_inform("Reduccion global parcial iniciada para job: %d|| Nodo: %s (%d resultados)",job,estado->nodo,gradoReduccionGlobal);
+			mlist_destroy(grupo, free);
+			free(nombre);
+		}
+	}
+	mlist_destroy(disponibles, NULL);
+}
+
+bool terminarReduccionGlobalParcial(char* nodo, int master, int job){
+	bool parcialDelNodo(t_Estado* estado){
+		return estado->job == job && estado->master == master && string_equals_ignore_case(estado->nodo, nodo)
+				&& string_equals_ignore_case(estado->etapa, "ReduccionGlobalParcial") && string_equals_ignore_case(estado->estado, "En proceso");
+	}
+	t_Estado* estado = mlist_find(listaEstados, parcialDelNodo);
+	if(estado == NULL) return false;
+	estado->estado = mstring_duplicate("FinalizadoOK");
+	log_print("Actualizacion en la tabla de estado: JOB:%d|MASTER:%d|NODO:%s|BLOQUE:%d|ETAPA:%s|ARCHIVOTEMPORAL:%s|ESTADO:%s",job,master,nodo,estado->block,estado->etapa,estado->archivoTemporal,estado->estado);
+	return true;
 }
 
 mlist_t* BuscoNodos(int master, int job){
@@ -444,9 +646,7 @@ char* seleccionarEncargado(mlist_t* NodosRL, int job){
 
 
 char* generarArchivoRG(int master, int job){
-	char* nombreArchivoTemporal = malloc(sizeof(char)*21);
-	sprintf(nombreArchivoTemporal,"/tmp/J%dMaster%d-final",job,master);
-	return nombreArchivoTemporal;
+	return mstring_create("/tmp/J%dMaster%d-final",job,master);
 
 }
 
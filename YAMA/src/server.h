@@ -7,6 +7,8 @@ typedef struct{
 	char * nodo;
 	int cargaActual;
 	int cargaHistorica;
+	int colaWorker; // Tareas esperando núcleo en el Worker, según su último reporte
+	double rendimiento; // Bytes por milisegundo observados en transformaciones (0 = sin datos)
 	mlist_t * cargaPorJob;
 } t_cargaPorNodo;
 
@@ -20,16 +22,22 @@ extern mlist_t * listaCargaPorNodo;
 void listen_to_master(void);
 void requerirInformacionFilesystem(t_serial*);
 void enviarEtapa_transformacion_Master(int,int,t_workerPlanificacion[],mlist_t*,int);
-void agregarAtablaEstado(int, char*,int,int,char*,char*,char*);
+t_Estado* agregarAtablaEstado(int, char*,int,int,char*,char*,char*);
 char* generarNombreArchivoTemporalTransf(int,int, int);
 void actualizoTablaEstado(char*,int,int,int,char*);
 bool verificoFinalizacionTransformacion(char* nodo,int bloque,int job);
+void verificarReduccionLocal(char*,int,int);
+void aparearParcial(char*,int,int);
+void terminarApareo(char*,int,int,bool);
 void mandarEtapaReduccionLocal(int,int,char*,t_infoNodo*,mlist_t*,char*);
 t_infoNodo* BuscoIP_PUERTO(char*);
 mlist_t* BuscoArchivosTemporales(char*,int,int);
 char* generarNombreTemporal_local(char*,int,int);
 bool verificoFinalizacionRl(int,int);
 void mandarEtapaReduccionGL(int,int);
+t_Estado* enviarReduccionGlobal(int,int,mlist_t*,char*,char*,int);
+void avanzarReduccionGlobal(int,int);
+bool terminarReduccionGlobalParcial(char*,int,int);
 mlist_t* BuscoNodos(int, int);
 char* seleccionarEncargado(mlist_t*, int);
 char* generarArchivoRG(int, int);
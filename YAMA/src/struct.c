@@ -5,11 +5,12 @@ mlist_t *nodelist_unpack(t_serial *serial) {
 	mlist_t *list = mlist_create();
 
 	int tamanioLista;
-	serial_remove(serial, "i", &tamanioLista);
+	t_serial_reader reader = serial_reader(serial);
+	serial_read(&reader, "i", &tamanioLista);
 
 	while(tamanioLista--) {
 		t_infoNodo *infonodo = malloc(sizeof(t_infoNodo));
-		serial_remove(serial,"sss",&infonodo->nodo,
+		serial_read(&reader,"sss",&infonodo->nodo,
 				&infonodo->ip,
 				&infonodo->puerto
 				);
@@ -8,11 +8,13 @@
 #ifndef STRUCT_H_
 #define STRUCT_H_
 #include <stdint.h>
+#include <stdbool.h>
 #include <mlist.h>
+#include <mtime.h>
 #include <serial.h>
 #include <stdlib.h>
 
-typedef struct{
+typedef struct t_Estado{
 	int job;
 	int master;
 	char* nodo;
@@ -20,6 +22,14 @@ typedef struct{
 	char* etapa;
 	char* archivoTemporal;
 	char* estado;
+	mtime_t inicio;
+	int duracion;				// Milisegundos hasta que terminó (-1 mientras no termine)
+	char* nodoAlternativo;		// Nodo con la otra copia del bloque (NULL si no hay)
+	int bloqueAlternativo;
+	int bytes;
+	bool especulativo;			// Si es la ejecución lanzada por especulación
+	struct t_Estado* copia;		// La otra ejecución del mismo bloque, si se especuló
+	struct t_Estado* apareo;	// Apareo parcial que tomó la salida de esta transformación
 
 }t_Estado;
 
@@ -44,6 +54,9 @@ typedef struct{
 	int bloque;
 	int response;
 	char* file;
+	int colaWorker; // -1 si el Worker no la informó
+	int bytes;
+	int duracion; // Milisegundos que tardó la transformación en el Worker
 } respuestaOperacionTranf;
 
 typedef struct{
@@ -60,6 +73,30 @@ typedef struct{
 typedef struct{
 	int idJOB;
 	char* file;
+	int combinar;
+	char* compresion;
+	int peso;
 }t_pedidoTrans;
 
+typedef struct{
+	int job;
+	int master;
+	char* extension; // Sufijo de los archivos intermedios según el códec del job
+	int peso; // Parte de los lugares de los nodos que le toca frente a otros jobs
+}t_Job;
+
+typedef struct{
+	char* nodo;
+	int enCurso;
+}t_ocupacionNodo;
+
+typedef struct{
+	int job;
+	int master;
+	int peso;
+	int enCurso;
+	mlist_t* espera; // t_Estado de transformaciones "En espera", en orden de llegada
+	mlist_t* liberadas;
+}t_colaJob;
+
 #endif /* STRUCT_H_ */
@@ -8,8 +8,10 @@ declare -A procs=([dnode]="DataNode" [fs]="FileSystem" [master]="Master" [worker
 [ -f "/usr/lib/libcommons.so" ]; libcommons_installed=$?
 dpkg-query -W -f='${Status}' libreadline6-dev 2>/dev/null | grep -q "install ok"; libreadline_installed=$?
 dpkg-query -W -f='${Status}' libssl-dev 2>/dev/null | grep -q "install ok"; libssl_installed=$?
+command -v lz4 &> /dev/null; lz4_installed=$?
+command -v zstd &> /dev/null; zstd_installed=$?
 
-if [ $libreadline_installed -ne 0 -o $libssl_installed -ne 0 -o $libcommons_installed -ne 0 ] ; then
+if [ $libreadline_installed -ne 0 -o $libssl_installed -ne 0 -o $libcommons_installed -ne 0 -o $lz4_installed -ne 0 -o $zstd_installed -ne 0 ] ; then
 	echo "Installing dependencies…"
 fi
 
@@ -42,6 +44,19 @@ rm -f *.deb
 echo -e "\r\e[0K • \e[1mlibssl-dev\e[0m: done."
 fi
 
+# Compresores de los archivos intermedios: el Worker no arranca sin ellos
+if [ $lz4_installed -ne 0 ] ; then
+echo -ne " • \e[1mlz4\e[0m: installing…"
+sudo apt-get install -y -qq lz4 &> /dev/null || sudo apt-get install -y -qq liblz4-tool &> /dev/null
+echo -e "\r\e[0K • \e[1mlz4\e[0m: done."
+fi
+
+if [ $zstd_installed -ne 0 ] ; then
+echo -ne " • \e[1mzstd\e[0m: installing…"
+sudo apt-get install -y -qq zstd &> /dev/null
+echo -e "\r\e[0K • \e[1mzstd\e[0m: done."
+fi
+
 if [ ! -d $base ]; then
 echo "Reticulating splines…"
 sleep 0.5